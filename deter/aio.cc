@@ -0,0 +1,338 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "aio.h"
+
+/**
+ * Implementation for the asynchronous I/O classes. io_uring is driven through its system
+ * calls directly, so there is no dependency on liburing. Elsewhere than on Linux only the
+ * pread/pwrite thread is built.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+#ifdef __linux__
+  template<typename P>
+    unsigned* at(void *base, P offset) { return (unsigned*) ((char*) base + offset); }
+
+  unsigned load_acquire(const unsigned *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+  void store_release(unsigned *p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+  int enter(int fd, unsigned submit, unsigned complete, unsigned flags) {
+    int r;
+    do {
+      r = (int) syscall(__NR_io_uring_enter, fd, submit, complete, flags, nullptr, 0);
+    } while (r < 0 && errno == EINTR);
+    return r;
+  }
+#endif
+
+  /**
+   * pread or pwrite until len bytes are done, the end of the file or an error.
+   */
+  long transfer(bool write, int fd, char *buf, size_t len, off_t offset) {
+    size_t total = 0;
+    while (total < len) {
+      ssize_t r = write ? pwrite(fd, buf + total, len - total, offset + total) : pread(fd, buf + total, len - total, offset + total);
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) return -errno;
+      if (r == 0) break;
+      total += (size_t) r;
+    }
+    return (long) total;
+  }
+
+}
+
+deter::IoQueue::IoQueue(unsigned depth, bool uring) : results(depth, 0), done(depth, 0), iovecs(depth) {
+#ifdef __linux__
+  io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  if (uring) ring_fd = (int) syscall(__NR_io_uring_setup, depth, &p);
+
+  if (ring_fd >= 0) {
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) sq_size = cq_size = std::max(sq_size, cq_size);
+    sqe_size = p.sq_entries * sizeof(io_uring_sqe);
+
+    sq_ring = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    cq_ring = single ? sq_ring : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    sqes = mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+      // the kernel has io_uring but will not share it, fall back
+      if (sqes != MAP_FAILED) munmap(sqes, sqe_size);
+      if (cq_ring != MAP_FAILED && !single) munmap(cq_ring, cq_size);
+      if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_size);
+      ::close(ring_fd);
+      ring_fd = -1;
+    } else {
+      sq_head = at(sq_ring, p.sq_off.head);
+      sq_tail = at(sq_ring, p.sq_off.tail);
+      sq_mask = at(sq_ring, p.sq_off.ring_mask);
+      sq_array = at(sq_ring, p.sq_off.array);
+      cq_head = at(cq_ring, p.cq_off.head);
+      cq_tail = at(cq_ring, p.cq_off.tail);
+      cq_mask = at(cq_ring, p.cq_off.ring_mask);
+      cqes = (char*) cq_ring + p.cq_off.cqes;
+    }
+  }
+#else
+  (void) uring;
+#endif
+
+  if (ring_fd < 0) worker = std::thread(&IoQueue::work, this);
+}
+
+deter::IoQueue::~IoQueue() {
+#ifdef __linux__
+  if (ring_fd >= 0) {
+    munmap(sqes, sqe_size);
+    if (cq_ring != sq_ring) munmap(cq_ring, cq_size);
+    munmap(sq_ring, sq_size);
+    ::close(ring_fd);
+    return;
+  }
+#endif
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+void deter::IoQueue::read(unsigned tag, int fd, char *buf, size_t len, off_t offset) {
+  submit({ false, fd, buf, len, offset, tag });
+}
+
+void deter::IoQueue::write(unsigned tag, int fd, const char *buf, size_t len, off_t offset) {
+  submit({ true, fd, (char*) buf, len, offset, tag });
+}
+
+void deter::IoQueue::submit(const request &r) {
+  if (ring_fd < 0) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done[r.tag] = 0;
+      pending.push_back(r);
+    }
+    wake.notify_one();
+    return;
+  }
+
+#ifdef __linux__
+  // one request per tag keeps the queue below its depth, there is always a free entry
+  done[r.tag] = 0;
+  iovecs[r.tag] = { r.buf, r.len };
+
+  const unsigned tail = *sq_tail;
+  const unsigned index = tail & *sq_mask;
+  io_uring_sqe *sqe = (io_uring_sqe*) sqes + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = r.write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = r.fd;
+  sqe->addr = (uint64_t) &iovecs[r.tag];
+  sqe->len = 1;
+  sqe->off = (uint64_t) r.offset;
+  sqe->user_data = r.tag;
+  sq_array[index] = index;
+  store_release(sq_tail, tail + 1);
+
+  if (enter(ring_fd, 1, 0, 0) < 0) {
+    results[r.tag] = -errno;
+    done[r.tag] = 1;
+  }
+#endif
+}
+
+void deter::IoQueue::reap(bool block) {
+#ifdef __linux__
+  unsigned head = *cq_head;
+  if (block && head == load_acquire(cq_tail)) enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+  const unsigned tail = load_acquire(cq_tail);
+  for (; head != tail; head++) {
+    const io_uring_cqe &cqe = ((const io_uring_cqe*) cqes)[head & *cq_mask];
+    results[cqe.user_data] = cqe.res;
+    done[cqe.user_data] = 1;
+  }
+  store_release(cq_head, head);
+#else
+  (void) block;
+#endif
+}
+
+long deter::IoQueue::wait(unsigned tag) {
+  if (ring_fd >= 0) {
+    while (!done[tag]) reap(true);
+    return results[tag];
+  }
+
+  std::unique_lock<std::mutex> guard(lock);
+  finished.wait(guard, [this, tag] { return done[tag] != 0; });
+  return results[tag];
+}
+
+void deter::IoQueue::work() {
+  for (;;) {
+    request r;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [this] { return stopping || !pending.empty(); });
+      if (pending.empty()) return;
+      r = pending.front();
+      pending.pop_front();
+    }
+
+    const long result = transfer(r.write, r.fd, r.buf, r.len, r.offset);
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      results[r.tag] = result;
+      done[r.tag] = 1;
+    }
+    finished.notify_all();
+  }
+}
+
+deter::AsyncReader::AsyncReader(const char *path, size_t chunk, unsigned buffers, bool uring)
+  : io(buffers, uring), chunk(chunk), slots(buffers, std::vector<char>(chunk)), offsets(buffers, 0), lengths(buffers, 0), busy(buffers, 0) {
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    fd = -1;
+    return;
+  }
+  size = st.st_size;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  for (unsigned slot=0; slot < buffers; slot++) request(slot);
+}
+
+deter::AsyncReader::~AsyncReader() {
+  for (unsigned slot=0; slot < slots.size(); slot++) {
+    if (busy[slot]) io.wait(slot);
+  }
+  if (fd >= 0) ::close(fd);
+}
+
+void deter::AsyncReader::request(unsigned slot) {
+  lengths[slot] = 0;
+  if (next >= size) return;
+
+  offsets[slot] = next;
+  lengths[slot] = (size_t) std::min<off_t>((off_t) chunk, size - next);
+  busy[slot] = 1;
+  io.read(slot, fd, slots[slot].data(), lengths[slot], next);
+  next += (off_t) lengths[slot];
+}
+
+deter::AsyncReader::int_type deter::AsyncReader::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  if (fd < 0 || failed) return traits_type::eof();
+
+  // the slot just consumed goes to the back of the ring with the next chunk
+  if (current >= 0) request((unsigned) current);
+  current = (current + 1) % (int) slots.size();
+  if (lengths[current] == 0) return traits_type::eof();
+
+  long got = io.wait((unsigned) current);
+  busy[current] = 0;
+  if (got >= 0 && (size_t) got < lengths[current]) {
+    // a short read, complete it in place so the chunks stay contiguous
+    const long more = transfer(false, fd, slots[current].data() + got, lengths[current] - got, offsets[current] + got);
+    got = (more < 0) ? more : got + more;
+  }
+  if (got <= 0) {
+    failed = true;
+    return traits_type::eof();
+  }
+
+  char *data = slots[current].data();
+  setg(data, data, data + got);
+  return traits_type::to_int_type(*gptr());
+}
+
+deter::AsyncWriter::AsyncWriter(const char *path, size_t chunk, unsigned buffers, bool uring)
+  : io(buffers, uring), chunk(chunk), slots(buffers, std::vector<char>(chunk)), lengths(buffers, 0), busy(buffers, 0), offsets(buffers, 0) {
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  setp(slots[0].data(), slots[0].data() + chunk);
+}
+
+deter::AsyncWriter::~AsyncWriter() {
+  close();
+}
+
+bool deter::AsyncWriter::close() {
+  if (fd < 0) return false;
+
+  flush_current();
+  for (unsigned slot=0; slot < slots.size(); slot++) settle(slot);
+  if (::close(fd) != 0) failed = true;
+  fd = -1;
+  return !failed;
+}
+
+deter::AsyncWriter::int_type deter::AsyncWriter::overflow(int_type c) {
+  if (fd < 0 || !flush_current()) return traits_type::eof();
+
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+bool deter::AsyncWriter::flush_current() {
+  const size_t len = (size_t) (pptr() - pbase());
+  if (len > 0) {
+    lengths[current] = len;
+    offsets[current] = next;
+    busy[current] = 1;
+    io.write(current, fd, pbase(), len, next);
+    next += (off_t) len;
+
+    // carry on in the oldest buffer once its write is done
+    current = (current + 1) % (unsigned) slots.size();
+    settle(current);
+  }
+
+  setp(slots[current].data(), slots[current].data() + chunk);
+  return !failed;
+}
+
+bool deter::AsyncWriter::settle(unsigned slot) {
+  if (!busy[slot]) return !failed;
+
+  long done = io.wait(slot);
+  busy[slot] = 0;
+  if (done >= 0 && (size_t) done < lengths[slot]) {
+    const long more = transfer(true, fd, slots[slot].data() + done, lengths[slot] - done, offsets[slot] + done);
+    done = (more < 0) ? more : done + more;
+  }
+  if (done < 0 || (size_t) done < lengths[slot]) failed = true;
+  return !failed;
+}
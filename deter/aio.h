@@ -0,0 +1,186 @@
+/**
+ * Asynchronous file input and output for the batch pipeline. AsyncReader and AsyncWriter
+ * are std::streambufs over a ring of buffers: the reader keeps the next chunks of the file
+ * being read while the current one is parsed, the writer hands each full buffer to the
+ * kernel and carries on filling the next one while it is written. The disk and the CPU
+ * are busy at the same time instead of taking turns.
+ *
+ * The I/O goes through io_uring when the kernel offers it, and otherwise (and on systems
+ * other than Linux) through plain pread and pwrite on a helper thread, which overlaps
+ * just the same.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef AIO_H
+#define AIO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace deter {
+
+  /**
+   * The default size of each buffer of AsyncReader and AsyncWriter.
+   */
+  const size_t IO_CHUNK = 1 << 20;
+
+  /**
+   * A queue of reads and writes that complete in the background. Every request carries a
+   * tag below the depth of the queue, and only one request per tag is in flight.
+   */
+  class IoQueue {
+    public:
+      /**
+       * @param depth - the number of tags.
+       * @param uring - false to use the pread/pwrite thread even if io_uring works.
+       */
+      explicit IoQueue(unsigned depth, bool uring = true);
+      ~IoQueue();
+
+      IoQueue(const IoQueue&) = delete;
+      IoQueue& operator=(const IoQueue&) = delete;
+
+      /**
+       * @return true if requests go through io_uring.
+       */
+      bool uring() const { return ring_fd >= 0; }
+
+      void read(unsigned tag, int fd, char *buf, size_t len, off_t offset);
+      void write(unsigned tag, int fd, const char *buf, size_t len, off_t offset);
+
+      /**
+       * Waits for the request of the given tag.
+       *
+       * @return the bytes transferred, or -errno.
+       */
+      long wait(unsigned tag);
+
+    private:
+      struct request {
+        bool write;
+        int fd;
+        char *buf;
+        size_t len;
+        off_t offset;
+        unsigned tag;
+      };
+
+      void submit(const request &r);
+      void reap(bool block);
+      void work();
+
+      std::vector<long> results;
+      std::vector<char> done;
+
+      // io_uring
+      int ring_fd = -1;
+      void *sq_ring = nullptr, *cq_ring = nullptr;
+      size_t sq_size = 0, cq_size = 0, sqe_size = 0;
+      unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+      unsigned *cq_head, *cq_tail, *cq_mask;
+      void *cqes, *sqes;
+      std::vector<iovec> iovecs;  // per tag, alive until its request completes
+
+      // pread/pwrite fallback
+      std::thread worker;
+      std::mutex lock;
+      std::condition_variable wake, finished;
+      std::deque<request> pending;
+      bool stopping = false;
+  };
+
+  /**
+   * Reads a file through a ring of buffers, keeping the reads of all but the one being
+   * consumed in flight.
+   */
+  class AsyncReader : public std::streambuf {
+    public:
+      /**
+       * @param path - the file to read.
+       * @param chunk - the size of each buffer.
+       * @param buffers - the number of buffers, 2 for double and 3 for triple buffering.
+       * @param uring - false to use the pread/pwrite fallback.
+       */
+      explicit AsyncReader(const char *path, size_t chunk = IO_CHUNK, unsigned buffers = 3, bool uring = true);
+      ~AsyncReader();
+
+      bool is_open() const { return fd >= 0; }
+      bool uring() const { return io.uring(); }
+
+    protected:
+      int_type underflow() override;
+
+    private:
+      void request(unsigned slot);
+
+      IoQueue io;
+      int fd = -1;
+      off_t size = 0;
+      size_t chunk;
+      std::vector<std::vector<char>> slots;
+      std::vector<off_t> offsets;
+      std::vector<size_t> lengths;
+      std::vector<char> busy;
+      off_t next = 0;      // offset of the next chunk to request
+      int current = -1;    // slot being consumed
+      bool failed = false;
+  };
+
+  /**
+   * Writes a file through a ring of buffers. A full buffer is handed to the kernel and
+   * the next one is filled while it is written; flushing does not force a write, the data
+   * reaches the file as buffers fill and on close.
+   */
+  class AsyncWriter : public std::streambuf {
+    public:
+      /**
+       * @param path - the file to write, truncated.
+       * @param chunk - the size of each buffer.
+       * @param buffers - the number of buffers, 2 for double and 3 for triple buffering.
+       * @param uring - false to use the pread/pwrite fallback.
+       */
+      explicit AsyncWriter(const char *path, size_t chunk = IO_CHUNK, unsigned buffers = 3, bool uring = true);
+      ~AsyncWriter();
+
+      bool is_open() const { return fd >= 0; }
+      bool uring() const { return io.uring(); }
+
+      /**
+       * Writes out everything and closes the file.
+       *
+       * @return false if any write failed.
+       */
+      bool close();
+
+    protected:
+      int_type overflow(int_type c) override;
+
+    private:
+      bool flush_current();
+      bool settle(unsigned slot);
+
+      IoQueue io;
+      int fd = -1;
+      size_t chunk;
+      std::vector<std::vector<char>> slots;
+      std::vector<size_t> lengths;
+      std::vector<char> busy;
+      std::vector<off_t> offsets;
+      off_t next = 0;
+      unsigned current = 0;
+      bool failed = false;
+  };
+
+}
+
+#endif
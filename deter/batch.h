@@ -0,0 +1,205 @@
+/**
+ * A batch mode for read_matrices aimed at inputs holding a very large number of small
+ * and medium matrices. Instead of read, compute, report, read... the work is split into
+ * a pipeline:
+ *
+ *   parser (calling thread) -> bounded window -> compute workers -> reporter (input order)
+ *
+ * The window holds at most depth matrices that have been read but not yet reported, the
+ * parser blocks when it is full. That bounds the memory used no matter how far the
+ * parser could run ahead, and no matter how long a single slow matrix holds back the
+ * in order output behind it.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deter.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * Reads and validates the matrices like read_matrices, computes their determinants on
+   * a pool of worker threads and reports the results in input order. The output is the
+   * same as read_matrices would produce, including the position of an error report.
+   * compute is called from several threads at once and must be safe to do so, report is
+   * only ever called from one thread at a time.
+   *
+   * An exception thrown by compute stops the pipeline: everything before the failing
+   * matrix is reported and the exception is rethrown to the caller.
+   *
+   * @param s - the input stream containing the matrix data to read.
+   * @param o - the output stream to write the result data to.
+   * @param compute - a function capable of computing the determinant for a given matrix.
+   * @param report - a reporting function that can format the result in a pleasing manner.
+   * @param threads - the number of compute workers, 0 for one per core.
+   * @param depth - the most matrices in flight at once, 0 for four per worker.
+   *
+   * @return an overall status, 0 being success and non-zero signaling failure.
+   */
+  template<typename T, typename R = T, typename In>
+    int read_matrices_batch(
+        In &s,
+        std::ostream &o,
+        typename identity<std::function<R(const Matrix<T>&)>>::type compute,
+        typename identity<std::function<void(std::ostream &o, const Matrix<T>&, const R, std::chrono::milliseconds)>>::type report,
+        unsigned threads = 0,
+        unsigned depth = 0) {
+
+      static_assert(is_matrix_value<T>::value, "Matrix value type is required.");
+
+      if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+      threads = std::min(threads, MAX_THREADS);
+      if (depth == 0) depth = 4 * threads;
+
+      struct slot {
+        Matrix<T> m;
+        R det {};
+        std::chrono::milliseconds ms { 0 };
+        std::exception_ptr error;
+        bool ready = false;
+      };
+
+      std::vector<slot> window(depth);
+      std::deque<long> work;        // sequence numbers waiting for a worker
+      long produced = 0;            // matrices read so far
+      long reported = 0;            // matrices reported so far
+      bool closed = false;          // the parser is done
+      bool failed = false;          // compute threw, stop everything
+      std::exception_ptr error;
+
+      std::mutex lock;
+      std::condition_variable space, pending, ready;
+
+      auto worker = [&]() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+          pending.wait(guard, [&]() { return !work.empty() || closed; });
+          if (work.empty()) return;
+
+          long seq = work.front();
+          work.pop_front();
+          slot &sl = window[seq % depth];
+          bool skip = failed;
+          guard.unlock();
+
+          // the slot is ours until it is marked ready
+          try {
+            std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            );
+            sl.det = skip ? R() : compute(sl.m);
+            std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            );
+            sl.ms = end - start;
+          } catch (...) {
+            sl.error = std::current_exception();
+          }
+
+          guard.lock();
+          sl.ready = true;
+          if (seq == reported) ready.notify_one();
+        }
+      };
+
+      auto reporter = [&]() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+          ready.wait(guard, [&]() {
+              return (reported < produced && window[reported % depth].ready) || (closed && reported == produced);
+          });
+          if (reported == produced) return;
+
+          slot &sl = window[reported % depth];
+          if (sl.error && !failed) {
+            failed = true;
+            error = sl.error;
+          }
+
+          if (!failed) {
+            guard.unlock();
+            report(o, sl.m, sl.det, sl.ms);
+            guard.lock();
+          }
+
+          sl.m = Matrix<T>();
+          sl.error = nullptr;
+          sl.ready = false;
+          reported++;
+          space.notify_one();
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for (unsigned i=0; i < threads; i++) workers.emplace_back(worker);
+      std::thread output(reporter);
+
+      auto enqueue = [&](Matrix<T> &m) {
+        std::unique_lock<std::mutex> guard(lock);
+        space.wait(guard, [&]() { return produced - reported < (long) depth; });
+        if (failed) return false;
+
+        slot &sl = window[produced % depth];
+        sl.m = std::move(m);
+        work.push_back(produced);
+        produced++;
+
+        pending.notify_one();
+        return true;
+      };
+
+      // an error is held back until everything read before it has been reported
+      bool bad_input = false;
+      std::string bad_msg;
+      char bad_char = 0;
+      auto hold_error = [&](const std::string &msg, const char &badc) {
+        bad_input = true;
+        bad_msg = msg;
+        bad_char = badc;
+      };
+
+      // the parser can throw too (values out of range, bad records, memory), the threads
+      // are stopped and joined first and the matrices before it still reported
+      int result = 1;
+      std::exception_ptr parse_error;
+      try {
+        result = parse_matrices<T>(s, enqueue, hold_error);
+      } catch (...) {
+        parse_error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+      }
+      pending.notify_all();
+      ready.notify_all();
+
+      for (auto &t : workers) t.join();
+      output.join();
+
+      if (error) std::rethrow_exception(error);
+      if (parse_error) std::rethrow_exception(parse_error);
+      if (bad_input) reportError(o, bad_msg, bad_char);
+
+      return result;
+    }
+
+}
+
+#endif
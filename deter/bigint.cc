@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+
+#include "bigint.h"
+
+/**
+ * Implementation for the BigInt class. Schoolbook arithmetic on 64 bit limbs, with
+ * unsigned __int128 for the carries.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+typedef unsigned __int128 u128;
+
+deter::BigInt::BigInt(__int128 v) : negative(v < 0) {
+  u128 m = (v < 0) ? (u128) 0 - (u128) v : (u128) v;
+  mag.push_back((uint64_t) m);
+  mag.push_back((uint64_t) (m >> 64));
+  trim();
+}
+
+void deter::BigInt::trim() {
+  while (!mag.empty() && mag.back() == 0) mag.pop_back();
+  if (mag.empty()) negative = false;
+}
+
+int deter::BigInt::compare_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y) {
+  if (x.size() != y.size()) return (x.size() < y.size()) ? -1 : 1;
+  for (size_t i=x.size(); i-- > 0;) {
+    if (x[i] != y[i]) return (x[i] < y[i]) ? -1 : 1;
+  }
+  return 0;
+}
+
+std::vector<uint64_t> deter::BigInt::add_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y) {
+  const std::vector<uint64_t> &a = (x.size() >= y.size()) ? x : y;
+  const std::vector<uint64_t> &b = (x.size() >= y.size()) ? y : x;
+
+  std::vector<uint64_t> r(a.size() + 1);
+  uint64_t carry = 0;
+  for (size_t i=0; i < a.size(); i++) {
+    u128 s = (u128) a[i] + ((i < b.size()) ? b[i] : 0) + carry;
+    r[i] = (uint64_t) s;
+    carry = (uint64_t) (s >> 64);
+  }
+  r[a.size()] = carry;
+  return r;
+}
+
+// x - y for |x| >= |y|
+std::vector<uint64_t> deter::BigInt::sub_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y) {
+  std::vector<uint64_t> r(x.size());
+  uint64_t borrow = 0;
+  for (size_t i=0; i < x.size(); i++) {
+    uint64_t yi = (i < y.size()) ? y[i] : 0;
+    uint64_t d = x[i] - yi - borrow;
+    borrow = (x[i] < yi) || (x[i] - yi < borrow);
+    r[i] = d;
+  }
+  return r;
+}
+
+deter::BigInt deter::BigInt::operator+(const BigInt &o) const {
+  BigInt r;
+  if (negative == o.negative) {
+    r.mag = add_magnitude(mag, o.mag);
+    r.negative = negative;
+  } else if (compare_magnitude(mag, o.mag) >= 0) {
+    r.mag = sub_magnitude(mag, o.mag);
+    r.negative = negative;
+  } else {
+    r.mag = sub_magnitude(o.mag, mag);
+    r.negative = o.negative;
+  }
+
+  r.trim();
+  return r;
+}
+
+deter::BigInt deter::BigInt::operator-() const {
+  BigInt r = *this;
+  r.negative = !negative && !mag.empty();
+  return r;
+}
+
+deter::BigInt deter::BigInt::operator-(const BigInt &o) const {
+  return *this + (-o);
+}
+
+deter::BigInt deter::BigInt::operator*(uint64_t k) const {
+  BigInt r;
+  r.mag.resize(mag.size() + 1);
+  uint64_t carry = 0;
+  for (size_t i=0; i < mag.size(); i++) {
+    u128 p = (u128) mag[i] * k + carry;
+    r.mag[i] = (uint64_t) p;
+    carry = (uint64_t) (p >> 64);
+  }
+  r.mag[mag.size()] = carry;
+  r.negative = negative;
+
+  r.trim();
+  return r;
+}
+
+deter::BigInt deter::BigInt::operator*(const BigInt &o) const {
+  BigInt r;
+  r.mag.assign(mag.size() + o.mag.size(), 0);
+  for (size_t i=0; i < mag.size(); i++) {
+    uint64_t carry = 0;
+    for (size_t j=0; j < o.mag.size(); j++) {
+      u128 p = (u128) mag[i] * o.mag[j] + r.mag[i + j] + carry;
+      r.mag[i + j] = (uint64_t) p;
+      carry = (uint64_t) (p >> 64);
+    }
+    r.mag[i + o.mag.size()] = carry;
+  }
+  r.negative = negative != o.negative;
+
+  r.trim();
+  return r;
+}
+
+int deter::BigInt::compare(const BigInt &o) const {
+  if (negative != o.negative) return negative ? -1 : 1;
+  int c = compare_magnitude(mag, o.mag);
+  return negative ? -c : c;
+}
+
+uint64_t deter::BigInt::mod(uint64_t p) const {
+  u128 rem = 0;
+  for (size_t i=mag.size(); i-- > 0;) rem = ((rem << 64) | mag[i]) % p;
+
+  uint64_t r = (uint64_t) rem;
+  return (negative && r != 0) ? p - r : r;
+}
+
+int deter::BigInt::bits() const {
+  if (mag.empty()) return 0;
+  return (int) (64 * (mag.size() - 1)) + (64 - __builtin_clzll(mag.back()));
+}
+
+double deter::BigInt::toDouble() const {
+  double r = 0;
+  for (size_t i=mag.size(); i-- > 0;) r = (r * 18446744073709551616.0) + (double) mag[i];
+  return negative ? -r : r;
+}
+
+std::string deter::BigInt::toString() const {
+  if (mag.empty()) return "0";
+
+  // peel off 19 decimal digits at a time
+  const uint64_t chunk = 10000000000000000000ull;
+  std::vector<uint64_t> m = mag;
+  std::string s;
+  while (!m.empty()) {
+    u128 rem = 0;
+    for (size_t i=m.size(); i-- > 0;) {
+      u128 cur = (rem << 64) | m[i];
+      m[i] = (uint64_t) (cur / chunk);
+      rem = cur % chunk;
+    }
+    while (!m.empty() && m.back() == 0) m.pop_back();
+
+    uint64_t digits = (uint64_t) rem;
+    for (int d=0; d < 19 && (!m.empty() || digits != 0); d++) {
+      s.push_back((char) ('0' + (digits % 10)));
+      digits /= 10;
+    }
+  }
+
+  if (negative) s.push_back('-');
+  std::reverse(s.begin(), s.end());
+  return s;
+}
+
+std::ostream& deter::operator<<(std::ostream &o, const BigInt &v) {
+  return o << v.toString();
+}
@@ -0,0 +1,79 @@
+/**
+ * BigInt is a minimal arbitrary precision signed integer, enough to hold and print
+ * determinants that do not fit in 128 bits. The magnitude is kept as little endian
+ * 64 bit limbs with no leading zero limbs, zero is never negative.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace deter {
+
+  class BigInt {
+    std::vector<uint64_t> mag;
+    bool negative;
+
+    public:
+      BigInt() : negative(false) { }
+      BigInt(__int128 v);
+
+      BigInt operator+(const BigInt &o) const;
+      BigInt operator-(const BigInt &o) const;
+      BigInt operator-() const;
+      BigInt operator*(const BigInt &o) const;
+      BigInt operator*(uint64_t k) const;
+
+      bool operator==(const BigInt &o) const { return negative == o.negative && mag == o.mag; }
+      bool operator!=(const BigInt &o) const { return !(*this == o); }
+      bool operator<(const BigInt &o) const { return compare(o) < 0; }
+      bool operator>(const BigInt &o) const { return compare(o) > 0; }
+
+      /**
+       * @return -1, 0 or 1 as this is less than, equal to or greater than o.
+       */
+      int compare(const BigInt &o) const;
+
+      /**
+       * @return -1, 0 or 1 for a negative, zero or positive value.
+       */
+      int sign() const { return mag.empty() ? 0 : (negative ? -1 : 1); }
+
+      /**
+       * @return the value modulo p, in [0, p).
+       */
+      uint64_t mod(uint64_t p) const;
+
+      /**
+       * @return the number of bits in the magnitude.
+       */
+      int bits() const;
+
+      /**
+       * @return the nearest double (infinite if out of range).
+       */
+      double toDouble() const;
+
+      /**
+       * @return the value in decimal.
+       */
+      std::string toString() const;
+
+    private:
+      static int compare_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y);
+      static std::vector<uint64_t> add_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y);
+      static std::vector<uint64_t> sub_magnitude(const std::vector<uint64_t> &x, const std::vector<uint64_t> &y);
+      void trim();
+  };
+
+  std::ostream& operator<<(std::ostream &o, const BigInt &v);
+
+}
+
+#endif
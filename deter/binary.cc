@@ -0,0 +1,111 @@
+#include <cstring>
+
+#include "binary.h"
+
+/**
+ * Implementation for the binary container.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+  const char MAGIC[8] = { 'D', 'E', 'T', 'E', 'R', 'B', 'I', 'N' };
+  const uint32_t ORDER_MARK = 0x01020304;
+}
+
+size_t deter::dtypeSize(uint32_t type) {
+  switch (type) {
+    case f64: return sizeof(double);
+    case f32: return sizeof(float);
+    case i64: return sizeof(int64_t);
+    case i32: return sizeof(int32_t);
+    default: return 0;
+  }
+}
+
+bool deter::isBinary(const char *first, const char *last) {
+  return (size_t) (last - first) >= sizeof(MAGIC) && memcmp(first, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+deter::BinaryWriter::BinaryWriter(std::ostream &out) : out(out), offset(sizeof(binary_header)) {
+  // room for the header, written by finish
+  binary_header header = {};
+  out.write((const char*) &header, sizeof(header));
+}
+
+void deter::BinaryWriter::pad() {
+  static const char zeros[BINARY_ALIGN] = {};
+  size_t extra = (BINARY_ALIGN - (offset % BINARY_ALIGN)) % BINARY_ALIGN;
+  out.write(zeros, extra);
+  offset += extra;
+}
+
+void deter::BinaryWriter::add(const Matrix<double> &m) {
+  binary_record record = {};
+  record.order = (uint32_t) m.order();
+  record.type = f64;
+  record.bytes = (uint64_t) m.order() * m.order() * sizeof(double);
+
+  index.push_back({ offset, record.order, record.type });
+  out.write((const char*) &record, sizeof(record));
+  for (int i=0; i < m.order(); i++) out.write((const char*) m.row(i), m.order() * sizeof(double));
+  offset += sizeof(record) + record.bytes;
+  pad();
+}
+
+void deter::BinaryWriter::finish() {
+  binary_header header = {};
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = BINARY_VERSION;
+  header.byte_order = ORDER_MARK;
+  header.count = index.size();
+  header.index_offset = offset;
+
+  out.write((const char*) index.data(), index.size() * sizeof(binary_entry));
+  out.seekp(0);
+  out.write((const char*) &header, sizeof(header));
+  out.flush();
+}
+
+deter::BinaryInput::BinaryInput(const char *first, const char *last) : first(first), last(last) {
+  const uint64_t size = (uint64_t) (last - first);
+  if (size < sizeof(binary_header) || !isBinary(first, last)) throw std::runtime_error("Not a binary matrix file");
+
+  binary_header header;
+  memcpy(&header, first, sizeof(header));
+  if (header.byte_order != ORDER_MARK) throw std::runtime_error("The binary matrix file was written with another byte order");
+  if (header.version != BINARY_VERSION) throw std::runtime_error("Unsupported binary matrix file version " + std::to_string(header.version));
+
+  if (header.index_offset % BINARY_ALIGN != 0 || header.index_offset < sizeof(binary_header) || header.index_offset > size
+      || header.count > (size - header.index_offset) / sizeof(binary_entry)) {
+    throw std::runtime_error("The index of the binary matrix file is out of bounds");
+  }
+
+  entries = (const binary_entry*) (first + header.index_offset);
+  entry_count = header.count;
+}
+
+const char* deter::BinaryInput::payload(uint64_t i, int &order, uint32_t &type) const {
+  const binary_entry &entry = entries[i];
+  const uint64_t index_offset = (uint64_t) ((const char*) entries - first);
+  auto bad = [i](const std::string &why) {
+    return std::runtime_error("Matrix " + std::to_string(i) + " of the binary matrix file " + why);
+  };
+
+  if (entry.offset % BINARY_ALIGN != 0 || entry.offset < sizeof(binary_header) || entry.offset > index_offset - sizeof(binary_record)) {
+    throw bad("is out of bounds");
+  }
+
+  binary_record record;
+  memcpy(&record, first + entry.offset, sizeof(record));
+  if (record.order != entry.order || record.type != entry.type) throw bad("does not match the index");
+  if (dtypeSize(record.type) == 0) throw bad("has an unknown value type");
+  if (record.order > (uint32_t) INT32_MAX || record.bytes != (unsigned __int128) record.order * record.order * dtypeSize(record.type)) {
+    throw bad("has an invalid size");
+  }
+  if (record.bytes > index_offset - entry.offset - sizeof(binary_record)) throw bad("is out of bounds");
+
+  order = (int) record.order;
+  type = record.type;
+  return first + entry.offset + sizeof(binary_record);
+}
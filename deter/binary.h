@@ -0,0 +1,240 @@
+/**
+ * A binary container for matrices that is read without any parsing. The layout, all
+ * integers little endian and every block 64 byte aligned:
+ *
+ *   header   magic "DETERBIN", version, byte order mark, matrix count, index offset
+ *   records  per matrix a 64 byte record (order, dtype, payload bytes) followed by the
+ *            n * n values row-major in the given dtype, padded to 64 bytes
+ *   index    count entries of (record offset, order, dtype)
+ *
+ * The payloads are aligned for the vector kernels, so a mapped file can be handed to the
+ * engines in place. Use deter -c to convert from the text format.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "deter.h"
+
+namespace deter {
+
+  const uint32_t BINARY_VERSION = 1;
+  const size_t BINARY_ALIGN = 64;
+
+  /**
+   * The value types a payload may hold.
+   */
+  enum dtype : uint32_t { f64 = 1, f32 = 2, i64 = 3, i32 = 4 };
+
+  struct binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  // 0x01020304 as written
+    uint64_t count;
+    uint64_t index_offset;
+    char reserved[32];
+  };
+
+  struct binary_record {
+    uint32_t order;
+    uint32_t type;
+    uint64_t bytes;
+    char reserved[48];
+  };
+
+  struct binary_entry {
+    uint64_t offset;
+    uint32_t order;
+    uint32_t type;
+  };
+
+  static_assert(sizeof(binary_header) == BINARY_ALIGN, "The header is one aligned block.");
+  static_assert(sizeof(binary_record) == BINARY_ALIGN, "A record is one aligned block.");
+
+  /**
+   * @return the size in bytes of one value of the type, 0 if the type is not known.
+   */
+  size_t dtypeSize(uint32_t type);
+
+  /**
+   * @return true if the bytes start like a binary container.
+   */
+  bool isBinary(const char *first, const char *last);
+
+  /**
+   * Writes a binary container. The header is written last, so the stream must be seekable.
+   */
+  class BinaryWriter {
+    std::ostream &out;
+    std::vector<binary_entry> index;
+    uint64_t offset;
+
+    public:
+      explicit BinaryWriter(std::ostream &out);
+
+      /**
+       * Appends a matrix of doubles.
+       *
+       * @param m - the matrix.
+       */
+      void add(const Matrix<double> &m);
+
+      /**
+       * Writes the index and the header.
+       */
+      void finish();
+
+    private:
+      void pad();
+  };
+
+  /**
+   * A binary container in memory, usually a MappedFile. The header and the index are
+   * checked on construction, each record when it is read.
+   */
+  class BinaryInput {
+    const char *first;
+    const char *last;
+    const binary_entry *entries = nullptr;
+    uint64_t entry_count = 0;
+
+    public:
+      /**
+       * @throw std::runtime_error if the header or the index are not valid.
+       */
+      BinaryInput(const char *first, const char *last);
+
+      uint64_t count() const { return entry_count; }
+
+      /**
+       * @param i - the matrix to read.
+       * @param order - receives the order of the matrix.
+       * @param type - receives the dtype of its payload.
+       * @return its payload.
+       * @throw std::runtime_error if the record is not valid.
+       */
+      const char* payload(uint64_t i, int &order, uint32_t &type) const;
+  };
+
+  /**
+   * Converts a payload of any dtype to T.
+   */
+  template<typename T>
+    Matrix<T> convertPayload(const char *payload, const int order, const uint32_t type) {
+      Matrix<T> m(order);
+      for (int i=0; i < order; i++) {
+        T *row = m.row(i);
+        const size_t first = (size_t) order * i;
+        for (int j=0; j < order; j++) {
+          switch (type) {
+            case f64: row[j] = (T) ((const double*) payload)[first + j]; break;
+            case f32: row[j] = (T) ((const float*) payload)[first + j]; break;
+            case i64: row[j] = (T) ((const int64_t*) payload)[first + j]; break;
+            default: row[j] = (T) ((const int32_t*) payload)[first + j]; break;
+          }
+        }
+      }
+      return m;
+    }
+
+  /**
+   * @return the dtype stored for values of type T, 0 if there is none.
+   */
+  template<typename T>
+    constexpr uint32_t dtypeOf() {
+      if constexpr (std::is_same<T, double>::value) return f64;
+      if constexpr (std::is_same<T, float>::value) return f32;
+      if constexpr (std::is_same<T, int64_t>::value) return i64;
+      if constexpr (std::is_same<T, int32_t>::value) return i32;
+      return 0;
+    }
+
+  /**
+   * parse_matrices over a binary container, for pipelines that take ownership of the
+   * matrices (batch mode): every matrix is copied into a buffer of its own. There is no
+   * character to hand an on_error, an invalid record throws as in read_binary_matrices.
+   */
+  template<typename T, typename OnMatrix, typename OnError>
+    int parse_matrices(BinaryInput &in, OnMatrix on_matrix, OnError) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      for (uint64_t i=0; i < in.count(); i++) {
+        int order;
+        uint32_t type;
+        const char *payload = in.payload(i, order, type);
+
+        Matrix<T> m = convertPayload<T>(payload, order, type);
+        if (!on_matrix(m)) return 0;
+      }
+
+      return 0;
+    }
+
+  /**
+   * read_matrices over a binary container. A payload already stored as T is handed to
+   * compute and report in place, with no parsing, copy or allocation; the others are
+   * converted.
+   *
+   * A payload in place is a dense view into the mapping, which the callbacks must not
+   * keep past their return.
+   *
+   * @param in - the container.
+   * @param o - the output stream to write the result data to.
+   * @param compute - a function capable of computing the determinant for a given matrix.
+   * @param report - a reporting function that can format the result in a pleasing manner.
+   * @return an overall status, 0 being success and non-zero signaling failure.
+   * @throw std::runtime_error if a record is not valid.
+   */
+  template<typename T, typename R = T>
+    int read_binary_matrices(
+        BinaryInput &in,
+        std::ostream &o,
+        typename identity<std::function<R(const Matrix<T>&)>>::type compute,
+        typename identity<std::function<void(std::ostream &o, const Matrix<T>&, const R, std::chrono::milliseconds)>>::type report) {
+
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      for (uint64_t i=0; i < in.count(); i++) {
+        int order;
+        uint32_t type;
+        const char *payload = in.payload(i, order, type);
+
+        // the mapping is read only, and so is the view of a payload in place
+        ConstView<T> in_place;
+        Matrix<T> converted;
+        if (type == dtypeOf<T>()) {
+          in_place = Matrix<T>::view((const T*) payload, order, order, order);
+        } else {
+          converted = convertPayload<T>(payload, order, type);
+        }
+        const Matrix<T> &m = (type == dtypeOf<T>()) ? in_place.get() : converted;
+
+        std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+        R det = compute(m);
+        std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+
+        report(o, m, det, end - start);
+      }
+
+      return 0;
+    }
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include <utility>
+
+#include "btf.h"
+
+/**
+ * Implementation for the block triangular decomposition: the matching and the strongly
+ * connected components, both with explicit stacks so orders in the hundred thousands do
+ * not run out of call stack.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+  /**
+   * Matches every row with a column it has a non-zero in, owner being the inverse.
+   *
+   * @return false if some row cannot be matched.
+   */
+  bool matchRows(const deter::sparse_pattern &rows, std::vector<int> &column, std::vector<int> &owner) {
+    const int n = rows.n;
+    column.assign(n, -1);
+    owner.assign(n, -1);
+
+    // the cheap assignment takes care of most rows
+    for (int i=0; i < n; i++) {
+      for (int k=rows.start[i]; k < rows.start[i + 1]; k++) {
+        if (owner[rows.index[k]] < 0) {
+          column[i] = rows.index[k];
+          owner[rows.index[k]] = i;
+          break;
+        }
+      }
+    }
+
+    // then an augmenting path from every row left, columns are visited once per search
+    std::vector<int> seen(n, -1);
+    std::vector<std::pair<int, int>> path; // (row, next entry of it to try)
+    for (int s=0; s < n; s++) {
+      if (column[s] >= 0) continue;
+
+      int found = -1;
+      path.assign(1, { s, rows.start[s] });
+      while (!path.empty() && found < 0) {
+        std::pair<int, int> &top = path.back();
+        if (top.second == rows.start[top.first + 1]) {
+          path.pop_back();
+          continue;
+        }
+
+        const int c = rows.index[top.second++];
+        if (seen[c] == s) continue;
+        seen[c] = s;
+
+        if (owner[c] < 0) found = c;
+        else path.push_back({ owner[c], rows.start[owner[c]] });
+      }
+      if (found < 0) return false;
+
+      // every row on the path takes the column the next one held
+      for (int x=(int) path.size() - 1, c=found; x >= 0; x--) {
+        const int r = path[x].first, held = column[r];
+        column[r] = c;
+        owner[c] = r;
+        c = held;
+      }
+    }
+
+    return true;
+  }
+
+}
+
+deter::block_form deter::blockTriangularForm(const sparse_pattern &rows) {
+  const int n = rows.n;
+  block_form form;
+  std::vector<int> owner;
+  if (!matchRows(rows, form.column, owner)) {
+    form.singular = true;
+    return form;
+  }
+
+  form.sign = permutationSign(form.column);
+
+  // Tarjan over the rows, row i leading to the owner of each column it has
+  std::vector<int> index(n, -1), low(n, 0), stack;
+  std::vector<unsigned char> on_stack(n, 0);
+  std::vector<std::pair<int, int>> calls; // (row, next entry of it to follow)
+  int counter = 0;
+  form.start.push_back(0);
+
+  for (int s=0; s < n; s++) {
+    if (index[s] >= 0) continue;
+
+    index[s] = low[s] = counter++;
+    stack.push_back(s);
+    on_stack[s] = 1;
+    calls.assign(1, { s, rows.start[s] });
+
+    while (!calls.empty()) {
+      std::pair<int, int> &top = calls.back();
+      const int v = top.first;
+
+      if (top.second < rows.start[v + 1]) {
+        const int w = owner[rows.index[top.second++]];
+        if (index[w] < 0) {
+          index[w] = low[w] = counter++;
+          stack.push_back(w);
+          on_stack[w] = 1;
+          calls.push_back({ w, rows.start[w] });
+        } else if (on_stack[w]) {
+          low[v] = std::min(low[v], index[w]);
+        }
+        continue;
+      }
+
+      calls.pop_back();
+      if (!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[v]);
+
+      if (low[v] == index[v]) {
+        int w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          on_stack[w] = 0;
+          form.rows.push_back(w);
+        } while (w != v);
+        form.start.push_back((int) form.rows.size());
+      }
+    }
+  }
+
+  return form;
+}
@@ -0,0 +1,128 @@
+/**
+ * Block triangular decomposition in front of the engines. A matrix that is reducible
+ * has row and column permutations making it block upper triangular, and its determinant
+ * is then the product of the determinants of the diagonal blocks. The columns are first
+ * matched to the rows so the diagonal is free of zeros (no such matching means the
+ * matrix is structurally singular), then the strongly connected components of the graph
+ * of the matched matrix are its irreducible diagonal blocks. The blocks are computed in
+ * parallel, each by the engine it suits.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef BTF_H
+#define BTF_H
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+#include "fixed.h"
+#include "matrix.h"
+#include "pool.h"
+#include "sparse.h"
+
+namespace deter {
+
+  /**
+   * The smallest order decomposed, the orders below have kernels fast enough as it is.
+   */
+  const int BTF_MIN_ORDER = FIXED_MAX + 1;
+
+  /**
+   * The block triangular form of a matrix. Row i is matched with column column[i]; the
+   * rows of block b are rows[start[b]] to rows[start[b + 1] - 1], and its columns are
+   * the columns matched with them, in the same order.
+   */
+  struct block_form {
+    bool singular = false; // no zero free diagonal exists
+    int sign = 1;          // the sign of the permutation of the columns
+    std::vector<int> column;
+    std::vector<int> rows;
+    std::vector<int> start;
+  };
+
+  /**
+   * Finds the block triangular form of a matrix from its pattern: a maximum matching of
+   * rows to columns by depth first augmenting paths, then Tarjan's strongly connected
+   * components of the graph with an edge from row i to row j wherever row i has a
+   * non-zero in the column matched with row j. Both run without recursion, in
+   * O(n * non-zeros) at worst and close to O(non-zeros) in practice.
+   *
+   * @param rows - the pattern of the matrix by rows.
+   * @return its form, singular if there is no zero free diagonal.
+   */
+  block_form blockTriangularForm(const sparse_pattern &rows);
+
+  /**
+   * Computes the determinant as the product of the determinants of the irreducible
+   * diagonal blocks. Blocks of order 1 are their value, the others are copied out and
+   * given to compute, on the threads of the pool when there is one. An irreducible matrix
+   * goes to compute as it is, a structurally singular one is 0 without any arithmetic.
+   *
+   * @param matrix - The matrix data.
+   * @param compute - the engine for the blocks.
+   * @param pool - threads for the blocks, or nullptr to compute them on the calling thread.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T, typename Compute>
+    T computeDeterminantBTF(const Matrix<T> &matrix, Compute compute, ThreadPool *pool) {
+      const int n = matrix.order();
+      if (n < BTF_MIN_ORDER) return compute(matrix);
+
+      const compressed<T> pattern = compressRows<T>(matrix);
+      if (pattern.index.size() == (size_t) n * n) return compute(matrix); // no zeros at all
+
+      const block_form form = blockTriangularForm(pattern);
+      if (form.singular) return 0;
+
+      const int blocks = (int) form.start.size() - 1;
+      if (blocks == 1) return compute(matrix);
+
+      // the larger blocks first, so they are not all left to the last worker
+      std::vector<int> large;
+      for (int b=0; b < blocks; b++) {
+        if (form.start[b + 1] - form.start[b] > 1) large.push_back(b);
+      }
+      std::sort(large.begin(), large.end(), [&](int a, int b) {
+          return form.start[a + 1] - form.start[a] > form.start[b + 1] - form.start[b];
+      });
+
+      std::vector<T> dets(blocks, T(1));
+      std::vector<std::exception_ptr> errors(blocks);
+      auto run = [&](const long x) {
+        const int b = large[x];
+        const int *rws = form.rows.data() + form.start[b];
+        const int size = form.start[b + 1] - form.start[b];
+        try {
+          Matrix<T> block(size);
+          for (int i=0; i < size; i++) {
+            const T *row = matrix.row(rws[i]);
+            for (int j=0; j < size; j++) block(i, j) = row[form.column[rws[j]]];
+          }
+          dets[b] = compute(block);
+        } catch (...) {
+          errors[b] = std::current_exception();
+        }
+      };
+
+      if (pool != nullptr) pool->parallel_for(0, (long) large.size(), run);
+      else for (long x=0; x < (long) large.size(); x++) run(x);
+
+      for (const std::exception_ptr &e : errors) {
+        if (e) std::rethrow_exception(e);
+      }
+
+      // multiplied in block order whatever order they were computed in
+      T det = form.sign;
+      for (int b=0; b < blocks; b++) {
+        const int first = form.rows[form.start[b]];
+        det *= (form.start[b + 1] - form.start[b] == 1) ? matrix(first, form.column[first]) : dets[b];
+      }
+      if (det == 0) det = 0; // no negative zero in the report
+      return det;
+    }
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "cache.h"
+
+/**
+ * Implementation for the result cache: MurmurHash3 and the memory mapped store.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+  const uint64_t C1 = 0x87c37b91114253d5ULL;
+  const uint64_t C2 = 0x4cf5ad432745937fULL;
+
+  /**
+   * The number of slots a new store starts with.
+   */
+  const uint64_t CACHE_CAPACITY = 1024;
+
+  inline uint64_t rotl(const uint64_t x, const int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  inline uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+  inline uint64_t load64(const unsigned char *b) {
+    uint64_t v;
+    std::memcpy(&v, b, 8);
+    return v;
+  }
+
+  size_t fileLength(const uint64_t capacity) {
+    return sizeof(deter::cache_header) + (capacity * sizeof(deter::cache_slot));
+  }
+
+  bool isValid(const deter::cache_header *h, const size_t length) {
+    return std::memcmp(h->magic, "DETCACHE", 8) == 0 && h->version == deter::CACHE_VERSION && h->byte_order == 0x01020304
+      && h->capacity > 0 && (h->capacity & (h->capacity - 1)) == 0 && length == fileLength(h->capacity);
+  }
+
+  /**
+   * @return the slot holding the key, or else the empty slot it would go to.
+   */
+  deter::cache_slot* probe(deter::cache_slot *slots, const uint64_t capacity, const deter::cache_key &key) {
+    for (uint64_t at=key.hash.lo & (capacity - 1);; at=(at + 1) & (capacity - 1)) {
+      deter::cache_slot *s = slots + at;
+      if (s->type == 0) return s;
+      if (s->lo == key.hash.lo && s->hi == key.hash.hi && s->order == key.order && s->type == key.type) return s;
+    }
+  }
+
+}
+
+void deter::Murmur3::block(const unsigned char *b) {
+  uint64_t k1 = load64(b), k2 = load64(b + 8);
+
+  k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+  h1 = rotl(h1, 27); h1 += h2; h1 = (h1 * 5) + 0x52dce729;
+
+  k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+  h2 = rotl(h2, 31); h2 += h1; h2 = (h2 * 5) + 0x38495ab5;
+}
+
+void deter::Murmur3::add(const void *data, size_t bytes) {
+  const unsigned char *b = (const unsigned char*) data;
+  length += bytes;
+
+  // top up a block left over from the last piece
+  if (pending > 0) {
+    const size_t take = std::min(bytes, 16 - pending);
+    std::memcpy(tail + pending, b, take);
+    pending += take;
+    b += take;
+    bytes -= take;
+    if (pending < 16) return;
+    block(tail);
+    pending = 0;
+  }
+
+  for (; bytes >= 16; b += 16, bytes -= 16) block(b);
+
+  std::memcpy(tail, b, bytes);
+  pending = bytes;
+}
+
+deter::hash128 deter::Murmur3::finish() {
+  uint64_t k1 = 0, k2 = 0;
+  for (size_t x=pending; x > 8; x--) k2 |= (uint64_t) tail[x - 1] << (8 * (x - 9));
+  for (size_t x=std::min(pending, (size_t) 8); x > 0; x--) k1 |= (uint64_t) tail[x - 1] << (8 * (x - 1));
+
+  if (pending > 8) {
+    k2 *= C2; k2 = rotl(k2, 33); k2 *= C1; h2 ^= k2;
+  }
+  if (pending > 0) {
+    k1 *= C1; k1 = rotl(k1, 31); k1 *= C2; h1 ^= k1;
+  }
+
+  uint64_t a = h1 ^ length, b = h2 ^ length;
+  a += b;
+  b += a;
+  a = fmix(a);
+  b = fmix(b);
+  a += b;
+  b += a;
+
+  hash128 h;
+  h.lo = a;
+  h.hi = b;
+  return h;
+}
+
+deter::CacheStore::CacheStore(const char *path) : path(path) {
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+  // another process growing the file would leave this mapping short of the table
+  if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+    int err = errno;
+    close(fd);
+    if (err == EWOULDBLOCK) throw std::runtime_error(std::string("The result cache is in use by another process: ") + path);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+
+  try {
+    if (st.st_size == 0) {
+      map(CACHE_CAPACITY);
+      std::memcpy(header()->magic, "DETCACHE", 8);
+      header()->version = CACHE_VERSION;
+      header()->byte_order = 0x01020304;
+      header()->capacity = CACHE_CAPACITY;
+      header()->count = 0;
+      return;
+    }
+
+    if ((size_t) st.st_size < sizeof(cache_header)) throw std::runtime_error(std::string("Not a result cache: ") + path);
+    cache_header h;
+    if (pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) || !isValid(&h, (size_t) st.st_size)) {
+      throw std::runtime_error(std::string("Not a result cache: ") + path);
+    }
+    map(h.capacity);
+  } catch (...) {
+    if (base != nullptr) munmap(base, length);
+    close(fd);
+    throw;
+  }
+}
+
+deter::CacheStore::~CacheStore() {
+  if (base != nullptr) munmap(base, length);
+  if (fd >= 0) close(fd);
+}
+
+void deter::CacheStore::map(const size_t capacity) {
+  const size_t bytes = fileLength(capacity);
+  if (ftruncate(fd, (off_t) bytes) < 0) throw std::system_error(errno, std::generic_category(), path);
+
+  void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) throw std::system_error(errno, std::generic_category(), path);
+
+  if (base != nullptr) munmap(base, length);
+  base = (char*) addr;
+  length = bytes;
+}
+
+void deter::CacheStore::grow() {
+  const uint64_t capacity = header()->capacity;
+  std::vector<cache_slot> kept(slots(), slots() + capacity);
+
+  // the old slots are emptied here, ftruncate extends the file with empty ones
+  std::memset(slots(), 0, capacity * sizeof(cache_slot));
+  map(capacity * 2);
+  header()->capacity = capacity * 2;
+
+  for (const cache_slot &s : kept) {
+    if (s.type == 0) continue;
+    cache_key key;
+    key.hash.lo = s.lo;
+    key.hash.hi = s.hi;
+    key.order = s.order;
+    key.type = s.type;
+    *probe(slots(), capacity * 2, key) = s;
+  }
+}
+
+bool deter::CacheStore::find(const cache_key &key, void *value) const {
+  const cache_slot *s = probe(slots(), header()->capacity, key);
+  if (s->type == 0) return false;
+  std::memcpy(value, s->value, CACHE_VALUE_BYTES);
+  return true;
+}
+
+void deter::CacheStore::insert(const cache_key &key, const void *value) {
+  if (key.type == 0) throw std::invalid_argument("A result cache key needs a type.");
+
+  cache_slot *s = probe(slots(), header()->capacity, key);
+  if (s->type == 0) {
+    if (2 * (header()->count + 1) > header()->capacity) {
+      grow();
+      s = probe(slots(), header()->capacity, key);
+    }
+    s->lo = key.hash.lo;
+    s->hi = key.hash.hi;
+    s->order = key.order;
+    s->type = key.type;
+    header()->count++;
+  }
+  std::memcpy(s->value, value, CACHE_VALUE_BYTES);
+}
+
+size_t deter::CacheStore::size() const {
+  return (size_t) header()->count;
+}
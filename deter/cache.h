@@ -0,0 +1,247 @@
+/**
+ * A content addressed cache of results. Every matrix is hashed, values only and row by
+ * row so the padding of its rows does not count, with the 128 bit MurmurHash3, and the
+ * hash together with the order and the dtype is the key its result is kept under. A
+ * matrix seen before, in this run or (with a store) an earlier one, costs a hash and a
+ * lookup instead of its computation.
+ *
+ * The store on disk is an open addressing table in a memory mapped file, so it is looked
+ * up in place without being read in. One process at a time has it, under an exclusive
+ * flock, a second one is refused.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "binary.h"
+#include "matrix.h"
+
+namespace deter {
+
+  const uint32_t CACHE_VERSION = 1;
+
+  /**
+   * The most bytes a result kept on disk may have.
+   */
+  const size_t CACHE_VALUE_BYTES = 16;
+
+  struct hash128 {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+  };
+
+  /**
+   * MurmurHash3 x64 128, fed in pieces of any size and giving the same hash as over the
+   * pieces back to back. The seed goes into both halves of the state.
+   */
+  class Murmur3 {
+    uint64_t h1, h2;
+    unsigned char tail[16];
+    size_t pending = 0;
+    uint64_t length = 0;
+
+    public:
+      explicit Murmur3(const uint64_t seed = 0) : h1(seed), h2(seed) { }
+
+      void add(const void *data, size_t bytes);
+      hash128 finish();
+
+    private:
+      void block(const unsigned char *b);
+  };
+
+  /**
+   * @return the hash of the values of a matrix, row by row.
+   */
+  template<typename T>
+    hash128 hashMatrix(const Matrix<T> &matrix, const uint64_t seed) {
+      Murmur3 h(seed);
+      for (int i=0; i < matrix.rows(); i++) h.add(matrix.row(i), sizeof(T) * matrix.cols());
+      return h.finish();
+    }
+
+  /**
+   * What a result is kept under.
+   */
+  struct cache_key {
+    hash128 hash;
+    uint32_t order;
+    uint32_t type;
+
+    bool operator==(const cache_key &o) const {
+      return hash.lo == o.hash.lo && hash.hi == o.hash.hi && order == o.order && type == o.type;
+    }
+  };
+
+  struct cache_key_hash {
+    size_t operator()(const cache_key &k) const { return (size_t) k.hash.lo; }
+  };
+
+  /**
+   * The store on disk: a 64 byte header, magic "DETCACHE", then a power of two of 48 byte
+   * slots probed linearly from the low bits of the hash. A slot with type 0 is empty. The
+   * file doubles, and its slots are put in place again, once it is half full.
+   */
+  struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  // 0x01020304 as written
+    uint64_t capacity;
+    uint64_t count;
+    char reserved[32];
+  };
+
+  struct cache_slot {
+    uint64_t lo;
+    uint64_t hi;
+    uint32_t order;
+    uint32_t type;
+    unsigned char value[CACHE_VALUE_BYTES];
+    char reserved[8];
+  };
+
+  static_assert(sizeof(cache_header) == 64, "The header is one 64 byte block.");
+  static_assert(sizeof(cache_slot) == 48, "A slot is 48 bytes.");
+
+  class CacheStore {
+    int fd = -1;
+    char *base = nullptr;
+    size_t length = 0;
+    std::string path;
+
+    public:
+      /**
+       * Opens the store, creating it if there is none.
+       *
+       * @param path - the file of the store.
+       * @throw std::system_error if it cannot be opened, created or mapped.
+       * @throw std::runtime_error if the file is not a store, or another process has it open.
+       */
+      explicit CacheStore(const char *path);
+      ~CacheStore();
+
+      CacheStore(const CacheStore&) = delete;
+      CacheStore& operator=(const CacheStore&) = delete;
+
+      /**
+       * @param value - receives the CACHE_VALUE_BYTES of the result when it is found.
+       * @return true if the key is in the store.
+       */
+      bool find(const cache_key &key, void *value) const;
+
+      /**
+       * Keeps CACHE_VALUE_BYTES of value under the key, replacing what was there.
+       */
+      void insert(const cache_key &key, const void *value);
+
+      /**
+       * @return the number of results in the store.
+       */
+      size_t size() const;
+
+    private:
+      cache_header* header() const { return (cache_header*) base; }
+      cache_slot* slots() const { return (cache_slot*) (base + sizeof(cache_header)); }
+      void map(size_t capacity);
+      void grow();
+  };
+
+  /**
+   * The results of an engine by the content of the matrices. The seed keeps the results
+   * of different engines, or the same engine under different options, apart. Results
+   * are kept in memory, and in a CacheStore as well when they are trivially copyable and
+   * no larger than CACHE_VALUE_BYTES. Safe to use from the threads of batch mode, the
+   * computations themselves run outside the lock.
+   */
+  template<typename R>
+    class ResultCache {
+      static constexpr bool persistent = std::is_trivially_copyable<R>::value && sizeof(R) <= CACHE_VALUE_BYTES;
+
+      const uint64_t seed;
+      std::unordered_map<cache_key, R, cache_key_hash> memory;
+      std::unique_ptr<CacheStore> disk;
+      std::mutex lock;
+      std::atomic<long> hit_count{0};
+      std::atomic<long> miss_count{0};
+
+      public:
+        /**
+         * @param name - what the results are of, the engine and its options.
+         * @param path - the store on disk, or nullptr to keep the results in memory only.
+         * @throw what CacheStore throws.
+         */
+        ResultCache(const std::string &name, const char *path) : seed(nameSeed(name)) {
+          if (path != nullptr && persistent) disk = std::make_unique<CacheStore>(path);
+        }
+
+        /**
+         * The result for a matrix, from the cache or else from compute, which is then
+         * kept for the next time.
+         */
+        template<typename T, typename Compute>
+          R get(const Matrix<T> &matrix, Compute compute) {
+            cache_key key;
+            key.hash = hashMatrix(matrix, seed);
+            key.order = (uint32_t) matrix.order();
+            key.type = dtypeOf<T>() ? dtypeOf<T>() : (uint32_t) (0x100 | sizeof(T));
+
+            {
+              std::lock_guard<std::mutex> guard(lock);
+              auto found = memory.find(key);
+              if (found != memory.end()) {
+                hit_count++;
+                return found->second;
+              }
+
+              if constexpr (persistent) {
+                unsigned char bytes[CACHE_VALUE_BYTES];
+                if (disk && disk->find(key, bytes)) {
+                  R value;
+                  std::memcpy((void*) &value, bytes, sizeof(R));
+                  memory.emplace(key, value);
+                  hit_count++;
+                  return value;
+                }
+              }
+            }
+
+            miss_count++;
+            R value = compute(matrix);
+
+            std::lock_guard<std::mutex> guard(lock);
+            memory.emplace(key, value);
+            if constexpr (persistent) {
+              if (disk) {
+                unsigned char bytes[CACHE_VALUE_BYTES] = {};
+                std::memcpy(bytes, (const void*) &value, sizeof(R));
+                disk->insert(key, bytes);
+              }
+            }
+            return value;
+          }
+
+        long hits() const { return hit_count; }
+        long misses() const { return miss_count; }
+
+      private:
+        static uint64_t nameSeed(const std::string &name) {
+          Murmur3 h;
+          h.add(name.data(), name.size());
+          return h.finish().lo;
+        }
+    };
+
+}
+
+#endif
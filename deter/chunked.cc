@@ -0,0 +1,60 @@
+#include "chunked.h"
+
+/**
+ * Implementation for the range start search of the parallel parser.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+  bool blank(char c) { return c == ' ' || c == '\t'; }
+
+  /**
+   * @return the number of blank separated values on the line starting at p.
+   */
+  long count_values(const char *p, const char *last) {
+    long count = 0;
+    while (p < last && *p != '\n') {
+      while (p < last && (blank(*p) || *p == '\r')) p++;
+      if (p == last || *p == '\n') break;
+      count++;
+      while (p < last && !blank(*p) && *p != '\r' && *p != '\n') p++;
+    }
+    return count;
+  }
+
+}
+
+const char* deter::findMatrixStart(const char *from, const char *last) {
+  // from the start of the line after the one holding from
+  const char *line = from;
+  while (line < last && *line != '\n') line++;
+  if (line < last) line++;
+
+  for (; line < last; line++) {
+    const char *p = line;
+    while (p < last && blank(*p)) p++;
+
+    const char *start = p;
+    long n = 0;
+    while (p < last && *p >= '0' && *p <= '9' && n < 100000000) n = (n * 10) + (*p++ - '0');
+
+    const char *q = p;
+    while (q < last && (blank(*q) || *q == '\r')) q++;
+
+    if (p > start && n > 0 && q < last && *q == '\n') {
+      // the first row, past any blank lines
+      const char *row = q + 1;
+      while (row < last && count_values(row, last) == 0) {
+        while (row < last && *row != '\n') row++;
+        if (row < last) row++;
+      }
+      if (row < last && count_values(row, last) == n) return start;
+    }
+
+    while (line < last && *line != '\n') line++;
+  }
+
+  return last;
+}
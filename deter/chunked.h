@@ -0,0 +1,169 @@
+/**
+ * Parallel parsing of one large input. The input is cut into byte ranges and each range
+ * is parsed on its own thread from the first line in it that looks like the start of a
+ * matrix: a lone order n, followed by a row of n values. That guess can be wrong (a row
+ * of a 1 x 1 matrix looks like an order too), so it is never trusted. Every range parses
+ * on until the matrix that ends just before the start of the next range, and its results
+ * are only used when the range before it really ended there. Where it did not, the gap is
+ * parsed again serially from the true position. Matrices, errors and the return value are
+ * those of parse_matrices on the same input, in the same order.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "deter.h"
+#include "mapped.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * The default size of the byte ranges parsed in parallel.
+   */
+  const size_t PARSE_CHUNK = 8 << 20;
+
+  /**
+   * An input for parse_matrices that is parsed in parallel ranges on a pool. Ranges are
+   * parsed a pool's worth at a time, so only that much input is held as parsed matrices.
+   */
+  struct ChunkedInput {
+    const char *first;
+    const char *last;
+    ThreadPool &pool;
+    size_t chunk;
+
+    ChunkedInput(const char *first, const char *last, ThreadPool &pool, size_t chunk = PARSE_CHUNK)
+      : first(first), last(last), pool(pool), chunk(std::max<size_t>(chunk, 1)) { }
+  };
+
+  /**
+   * @param from - where to start looking, the line holding it is skipped.
+   * @param last - the end of the input.
+   * @return the first character of the first line after from that is a lone order
+   * n followed by a line of n values, or last if there is none.
+   */
+  const char* findMatrixStart(const char *from, const char *last);
+
+  /**
+   * What parsing one range produced.
+   */
+  template<typename T>
+    struct parsed_range {
+      std::vector<Matrix<T>> matrices;
+      enum { finished, failed, stopped } how = finished;
+      std::string msg;
+      char badc = 0;
+      const char *resume = nullptr; // when stopped, where parsing continues
+      bool synced = false;          // when stopped, whether resume is the bound
+    };
+
+  /**
+   * Parses from a position where parse_matrices would be waiting for the next matrix,
+   * stopping after the last matrix that ends before bound.
+   *
+   * @param from - where to start.
+   * @param last - the end of the input.
+   * @param bound - the start of the next range, last for none.
+   */
+  template<typename T>
+    parsed_range<T> parse_range(const char *from, const char *last, const char *bound) {
+      parsed_range<T> r;
+      BufferInput in(from, last);
+
+      auto keep = [&](Matrix<T> &m) {
+        r.matrices.push_back(std::move(m));
+        if (bound == last) return true;
+
+        // between matrices the parser skips blanks and line breaks only, so the next
+        // one starts at the bound exactly when nothing else lies in between
+        const char *e = in.position();
+        const char *q = e;
+        while (q < bound && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r')) q++;
+        if (q < bound) return true;
+
+        r.how = parsed_range<T>::stopped;
+        r.synced = (q == bound);
+        r.resume = r.synced ? bound : e;
+        return false;
+      };
+
+      auto fail = [&](const std::string &msg, const char &badc) {
+        r.how = parsed_range<T>::failed;
+        r.msg = msg;
+        r.badc = badc;
+      };
+
+      parse_matrices<T>(in, keep, fail);
+      return r;
+    }
+
+  /**
+   * parse_matrices over a ChunkedInput. The callbacks are called on the calling thread,
+   * in input order, exactly as the serial parser would call them.
+   */
+  template<typename T, typename OnMatrix, typename OnError>
+    int parse_matrices(ChunkedInput &in, OnMatrix on_matrix, OnError on_error) {
+      const char *last = in.last;
+      const char *round = in.first;
+      const size_t ranges = std::max(1u, in.pool.size());
+
+      while (true) {
+        // guessed starts of the ranges of this round, starts[0] is known to be right
+        std::vector<const char*> starts { round };
+        for (size_t k=1; k <= ranges; k++) {
+          const char *guess = last;
+          if ((size_t) (last - round) > k * in.chunk) guess = findMatrixStart(round + (k * in.chunk), last);
+          if (guess <= starts.back()) guess = last;
+          starts.push_back(guess);
+          if (guess == last) break;
+        }
+        const size_t count = starts.size() - 1;
+
+        std::vector<parsed_range<T>> parsed(count);
+        in.pool.parallel_for(0, (long) count, [&](long k) {
+            parsed[k] = parse_range<T>(starts[k], last, starts[k + 1]);
+        });
+
+        // stitch: parsed[k] is used only when the parse before it stopped at starts[k]
+        size_t k = 0;
+        parsed_range<T> cur = std::move(parsed[0]);
+        while (true) {
+          for (auto &m : cur.matrices) {
+            if (!on_matrix(m)) return 0;
+          }
+
+          if (cur.how == parsed_range<T>::failed) {
+            on_error(cur.msg, cur.badc);
+            return 1;
+          }
+          if (cur.how == parsed_range<T>::finished) return 0;
+
+          if (cur.synced) {
+            k++;
+            if (k == count) { round = cur.resume; break; }
+            cur = std::move(parsed[k]);
+            continue;
+          }
+
+          // the guess at starts[k + 1] was wrong, parse the gap to the next one again
+          size_t next = k + 1;
+          while (next < count && starts[next] <= cur.resume) next++;
+          if (next == count) { round = cur.resume; break; }
+
+          k = next - 1;
+          cur = parse_range<T>(cur.resume, last, starts[next]);
+        }
+      }
+    }
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "decimal.h"
+#include "exact.h"
+
+/**
+ * Implementation for the exact decimal mode.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+  const int64_t MAX_UNSCALED = INT64_MAX / 10;
+
+  int64_t times10(int64_t v) {
+    if (v > MAX_UNSCALED || v < -MAX_UNSCALED) throw std::out_of_range("A decimal value has too many digits to be read exactly");
+    return v * 10;
+  }
+
+  /**
+   * Places the decimal point scale digits from the right of the digits of |unscaled|,
+   * keeping at least min_fraction digits after it.
+   */
+  std::string place_point(const std::string &digits, const bool negative, const int scale, const int min_fraction) {
+    std::string s = digits;
+    if ((int) s.size() <= scale) s.insert(0, (scale + 1) - s.size(), '0');
+
+    std::string whole = s.substr(0, s.size() - scale);
+    std::string fraction = s.substr(s.size() - scale);
+    while ((int) fraction.size() > min_fraction && fraction.back() == '0') fraction.pop_back();
+    while ((int) fraction.size() < min_fraction) fraction.push_back('0');
+
+    return (negative ? "-" : "") + whole + (fraction.empty() ? "" : "." + fraction);
+  }
+
+  std::string digits_of(int64_t v) {
+    std::string s = std::to_string(v);
+    return (s[0] == '-') ? s.substr(1) : s;
+  }
+
+}
+
+std::istream& deter::operator>>(std::istream &in, Fixed &v) {
+  std::istream::sentry guard(in);
+  if (guard) readValue(in, v);
+  return in;
+}
+
+std::ostream& deter::operator<<(std::ostream &o, const Fixed &v) {
+  return o << place_point(digits_of(v.unscaled), v.unscaled < 0, v.scale, 0);
+}
+
+std::ostream& deter::operator<<(std::ostream &o, const Decimal &v) {
+  std::string digits = v.unscaled.toString();
+  const bool negative = digits[0] == '-';
+  if (negative) digits.erase(0, 1);
+
+  return o << place_point(digits, negative, v.scale, 0);
+}
+
+std::string deter::to_string(const Fixed &v) {
+  return place_point(digits_of(v.unscaled), v.unscaled < 0, v.scale, std::max(v.scale, 1));
+}
+
+deter::Decimal deter::scaledDeterminant(const Matrix<Fixed> &matrix, ThreadPool *pool) {
+  Decimal det;
+  const int size = matrix.order();
+  if (size < 1) return det;
+
+  int scale = 0;
+  for (int i=0; i < size; i++) {
+    for (int j=0; j < size; j++) scale = std::max(scale, matrix(i, j).scale);
+  }
+
+  std::vector<int64_t> a((size_t) size * size);
+  for (int i=0; i < size; i++) {
+    for (int j=0; j < size; j++) {
+      int64_t v = matrix(i, j).unscaled;
+      for (int s=matrix(i, j).scale; s < scale; s++) v = times10(v);
+      a[((size_t) size * i) + j] = v;
+    }
+  }
+
+  det.unscaled = exactDeterminant(size, a.data(), pool);
+  det.scale = scale * size;
+  return det;
+}
+
+deter::Decimal deter::computeDeterminantDecimal(const Matrix<Fixed> &matrix) {
+  return scaledDeterminant(matrix, nullptr);
+}
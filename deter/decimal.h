@@ -0,0 +1,147 @@
+/**
+ * Exact decimal input. Values such as -40.59 have no exact double, so in decimal mode
+ * they are read as Fixed, an integer with a count of decimal places. A matrix whose
+ * values have at most s places is 10^-s times an integer matrix N, so
+ *
+ *   det(M) = det(N) / 10^(s * n)
+ *
+ * and det(N) comes from an exact integer engine. The result is a Decimal, printed in
+ * full with no rounding at all.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "bigint.h"
+#include "deter.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * A decimal value read exactly: unscaled * 10^-scale.
+   */
+  struct Fixed {
+    int64_t unscaled = 0;
+    int scale = 0;
+  };
+
+  template<>
+    struct is_matrix_value<Fixed> : std::true_type { };
+
+  /**
+   * An exact decimal result: unscaled * 10^-scale.
+   */
+  struct Decimal {
+    BigInt unscaled;
+    int scale = 0;
+  };
+
+  /**
+   * Reads a decimal number the way operator>> reads a double (an optional sign, digits
+   * with an optional point, an optional exponent), but exactly. Whitespace has already
+   * been skipped. Sets failbit if there is no number.
+   *
+   * @param in - an std::istream or anything with its peek, get and setstate.
+   * @param v - receives the value.
+   * @throw std::out_of_range if the digits do not fit 63 bits.
+   */
+  template<typename In>
+    void readValue(In &in, Fixed &v) {
+      auto shift = [](int64_t x, int digit) {
+        if (x > (INT64_MAX - digit) / 10) throw std::out_of_range("A decimal value has too many digits to be read exactly");
+        return (x * 10) + digit;
+      };
+
+      bool negative = false;
+      if (in.peek() == '-' || in.peek() == '+') negative = (in.get() == '-');
+
+      int64_t unscaled = 0;
+      int scale = 0;
+      bool digits = false, point = false;
+      while (true) {
+        int c = in.peek();
+        if (c >= '0' && c <= '9') {
+          unscaled = shift(unscaled, c - '0');
+          if (point) scale++;
+          digits = true;
+        } else if (c == '.' && !point) {
+          point = true;
+        } else {
+          break;
+        }
+        in.get();
+      }
+
+      if (!digits) {
+        in.setstate(std::ios::failbit);
+        return;
+      }
+
+      if (in.peek() == 'e' || in.peek() == 'E') {
+        in.get();
+        bool negative_exp = false;
+        if (in.peek() == '-' || in.peek() == '+') negative_exp = (in.get() == '-');
+        if (!isdigit(in.peek())) {
+          in.setstate(std::ios::failbit);
+          return;
+        }
+
+        int exp = 0;
+        while (isdigit(in.peek())) exp = std::min((exp * 10) + (in.get() - '0'), 100000);
+        scale += negative_exp ? exp : -exp;
+        for (; scale < 0; scale++) unscaled = shift(unscaled, 0);
+      }
+
+      v.unscaled = negative ? -unscaled : unscaled;
+      v.scale = scale;
+    }
+
+  /**
+   * Reads a Fixed with readValue after the usual skip of whitespace.
+   */
+  std::istream& operator>>(std::istream &in, Fixed &v);
+
+  /**
+   * Writes the value with the trailing zeros of its fraction dropped, honouring the
+   * stream width.
+   */
+  std::ostream& operator<<(std::ostream &o, const Fixed &v);
+  std::ostream& operator<<(std::ostream &o, const Decimal &v);
+
+  /**
+   * @return the value in the form std::to_string gives a double, every digit with at
+   * least one after the point (reportResult sizes its columns from this).
+   */
+  std::string to_string(const Fixed &v);
+
+  /**
+   * Computes the exact determinant of a matrix of decimals by scaling it to integers
+   * (see exactDeterminant) and back.
+   *
+   * @param matrix - The matrix data.
+   * @param pool - threads for the multi-modular engine, or nullptr to run on the calling thread.
+   * @return the determinant for the given matrix.
+   * @throw std::out_of_range if a value scaled to the most decimal places does not fit 63 bits.
+   */
+  Decimal scaledDeterminant(const Matrix<Fixed> &matrix, ThreadPool *pool);
+
+  /**
+   * scaledDeterminant on the calling thread, with the compute callback signature.
+   */
+  Decimal computeDeterminantDecimal(const Matrix<Fixed> &matrix);
+
+}
+
+#endif
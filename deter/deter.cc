@@ -13,3 +13,12 @@ bool deter::isNumeric(const char &c) {
   return ((c != 0x2f) && (c > 0x2c && c < 0x3a));
 }
 
+/**
+ * Implementation for the reportError function.
+ */
+void deter::reportError(std::ostream &o, const std::string &msg, const char &badc) {
+  o << "ERROR -- Processing stopped. " << std::endl;
+  o << "Error during processing: " << msg << "0x" << std::hex << (int) badc << std::endl;
+
+  //std::cerr << "Error during processing: " << msg << "0x" << std::hex << (int) badc << std::endl;
+}
@@ -11,6 +11,15 @@
 #include <memory>
 #include <iomanip>
 #include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "format.h"
+#include "fixed.h"
 
 /**
  * The deter namespace contains all the functionality required for the assignment.
@@ -22,11 +31,60 @@
  */
 namespace deter {
 
+  /**
+   * identity holds a type unchanged. A parameter spelled through it is not deduced, so
+   * the templates below take lambdas for their callbacks with only T given explicitly.
+   */
+  template<typename X>
+    struct identity { typedef X type; };
+
+  /**
+   * is_matrix_value tells the reading and reporting templates which types a matrix may
+   * hold: the arithmetic types, plus any type that specializes it (see Fixed).
+   */
+  template<typename T>
+    struct is_matrix_value : std::is_arithmetic<T> { };
+
   /**
    * read_state is a simple enum used in the parsing of the input stream
    * see the implementation of read_matrices for more information.
    */
-  enum read_state { wait, size, rows };
+  enum read_state { wait, size, rows, keyword };
+
+  /**
+   * The directives parse_matrices accepts after a matrix when it is given on_directive.
+   * "rhs k" on a line of its own is followed by a block of right hand sides, n rows of k
+   * values for the order n of the matrix before it. "update row i" and "update column j"
+   * are followed by one line of n values, the new row i or column j (from the top down)
+   * of that matrix.
+   */
+  enum directive_kind { rhs_block, update_row, update_column };
+
+  /**
+   * The largest order, and number of right hand sides, the parser accepts. A row of that
+   * many doubles is 8 MB; the rows are allocated as they are read, never all up front.
+   */
+  const int MAX_ORDER = 1 << 20;
+
+  /**
+   * The bytes of rows the parser allocates before reading them, more are added as they
+   * are read.
+   */
+  const size_t PARSE_AHEAD = 1 << 20;
+
+  struct read_directive {
+    directive_kind kind;
+    int count; // the columns of a block of right hand sides, the row or column to update
+  };
+
+  /**
+   * The on_directive of parse_matrices when there is none, a directive is then invalid
+   * input like any other letter.
+   */
+  struct no_directives {
+    template<typename T>
+      bool operator()(const read_directive&, Matrix<T>&) const { return true; }
+  };
 
   /**
    * A very simple function to determine if the given
@@ -37,7 +95,16 @@ namespace deter {
   bool isNumeric(const char &c);
 
   /**
-   * read_matrices is the most lengthy function in our application. It is complicated by
+   * Writes the message read_matrices reports invalid input with.
+   *
+   * @param o - the output stream to write the message to.
+   * @param msg - what was expected.
+   * @param badc - the offending character.
+   */
+  void reportError(std::ostream &o, const std::string &msg, const char &badc);
+
+  /**
+   * parse_matrices is the most lengthy function in our application. It is complicated by
    * the need to validate the input. The parser is quite lenient in terms of whitespace
    * but does not tolerate non-numeric data or invalid sizes or ordering. The passed in
    * input stream should consist of a series of an integer representing the order of the 
@@ -46,23 +113,26 @@ namespace deter {
    * correct number of complete rows. Any errant newlines or characters will result in
    * exection being halted.
    *
+   * Every complete matrix is handed to on_matrix, which may keep it by moving it out.
+   * Otherwise its storage is reused for the next matrix, so a reader that is done with
+   * each matrix when on_matrix returns parses the whole input without allocating.
+   *
+   * The input is anything with the peek, get, eof and extraction semantics of an
+   * std::istream, in particular a BufferInput over a mapped file.
+   *
    * @param s - the input stream containing the matrix data to read.
-   * @param o - the output stream to write the result data to.
-   * @param compute - a function capable of computing the determinant for a given matrix.
-   * @param report - a reporting function that can format the result in a pleasing manner.
+   * @param on_matrix - called as on_matrix(m) with each Matrix<T>, returning false stops parsing.
+   * @param on_error - called as on_error(msg, badc) when invalid input stops parsing.
+   * @param on_directive - called as on_directive(d, block) with each directive and its
+   * block of values (see read_directive), returning false stops parsing.
    *
    * @return an overall status, 0 being success and non-zero signaling failure.
    */
-  template<typename T>
-    int read_matrices(
-        std::istream &s, 
-        std::ostream &o,
-        std::function<T(const int, const std::unique_ptr<T[]>&)> compute, 
-        std::function<void(std::ostream &o, const int, const std::unique_ptr<T[]>&, const T, std::chrono::milliseconds)> report) {
-
-      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+  template<typename T, typename In, typename OnMatrix, typename OnError, typename OnDirective>
+    int parse_matrices(In &s, OnMatrix on_matrix, OnError on_error, OnDirective on_directive) {
+      constexpr bool directives = !std::is_same<OnDirective, no_directives>::value;
 
-      auto expect_ws_to_num = [](std::istream &in) {
+      auto expect_ws_to_num = [](In &in) {
         while (in) {
           if (isNumeric(in.peek())) {
             return true;
@@ -79,7 +149,7 @@ namespace deter {
         return true; // eof
       };
 
-      auto expect_wscr_to_num = [](std::istream &in, bool require) {
+      auto expect_wscr_to_num = [](In &in, bool require) {
         bool cr_seen = !require;
         while (in) {
           if (isNumeric(in.peek())) {
@@ -105,23 +175,52 @@ namespace deter {
         return !require; // eof
       };
 
-      auto report_error = [&](const std::string &msg, const char &badc) {
-        o << "ERROR -- Processing stopped. " << std::endl;
-        o << "Error during processing: " << msg << "0x" << std::hex << (int) badc << std::endl;
+      // r rows of c values into b, every row on a line of its own. b has c columns and
+      // gets its rows as they are read, so a declared order the input does not back up
+      // costs no more memory than the input itself
+      auto read_block = [&](Matrix<T> &b, const int r, const int c) {
+        if (r > 0 && c > 0) b.reserveRows(std::min(r, std::max(1, (int) (PARSE_AHEAD / (sizeof(T) * b.stride())))));
+        for (int i=0; i < r; i++) {
+          b.resizeRows(i + 1);
+          T *value = b.row(i);
+          for (int j=0; j < c; j++) {
+            s >> value[j];
+
+            if (j+1 == c) {
+              const bool last = (i+1 == r);
+              if (!expect_wscr_to_num(s, !last) && !(directives && last && std::isalpha((unsigned char) s.peek()))) {
+                on_error("Invalid data and end of row: ", s.peek());
+                return false;
+              }
+              continue;
+            }
+
+            // otherwise, we expect just whitespace
+            if (!expect_ws_to_num(s)) {
+              on_error("Invalid row data: ", s.peek());
+              return false;
+            }
+          }
+        }
 
-        //std::cerr << "Error during processing: " << msg << "0x" << std::hex << (int) badc << std::endl;
+        return true;
       };
 
       // let's be a state machine
       read_state current_state = wait;
       int current_size = -1;
-      std::unique_ptr<T[]> m;
+      Matrix<T> m, block;
 
       while (s) {
         switch (current_state) {
           case wait:
             if (!expect_wscr_to_num(s, false)) {
-              report_error(
+              if (directives && current_size >= 0 && std::isalpha((unsigned char) s.peek())) {
+                current_state = keyword;
+                break;
+              }
+
+              on_error(
                   "Expected to find whitespace or newlines until numeric but found:", 
                   s.peek());
               return 1;
@@ -131,131 +230,569 @@ namespace deter {
             break;
           case size:
             if (!isNumeric(s.peek())) { 
-              report_error(
+              on_error(
                   "Expected to read size but found: ", 
                   s.peek());
               return 1;
             }
 
+            if (s.peek() == '-') {
+              on_error(
+                  "Expected to read a size that is not negative but found: ",
+                  s.peek());
+              return 1;
+            }
+
             s >> current_size;
-            m.reset(new T[current_size * current_size]);
             if (!expect_wscr_to_num(s, true)) {
-              report_error(
+              on_error(
                   "Expected to find whitespace or newlines until numeric on next line but found:", 
                   s.peek());
               return 1;
             }
 
+            if (current_size > MAX_ORDER) {
+              on_error("Expected an order of at most " + std::to_string(MAX_ORDER) + " but found: ", s.peek());
+              return 1;
+            }
+
+            m.resize(0, current_size);
+
             current_state = rows;
 
             break;
           case rows:
             // we expect current_size x current_size rows. Let's validate that.
-            for (int i=0; i < (current_size*current_size); i++) {
-              s >> m[i]; 
-
-              if (((i+1) % current_size) == 0) {
-                if (!expect_wscr_to_num(s, (i+1 < (current_size*current_size)))) {
-                  report_error("Invalid data and end of row: ", s.peek());
-                  return 1;
-                }
-                continue;
-              }
+            if (!read_block(m, current_size, current_size)) return 1;
 
-              // otherwise, we expect just whitespace
-              if (!expect_ws_to_num(s)) {
-                report_error("Invalid row data: ", s.peek());
+            if (!on_matrix(m)) return 0;
+
+            current_state = wait;
+            break;
+          case keyword: {
+            // "rhs k", "update row i" or "update column j"
+            std::string word;
+            while (std::isalpha((unsigned char) s.peek())) word += (char) s.get();
+
+            read_directive d = { rhs_block, 0 };
+            if (word == "update") {
+              expect_ws_to_num(s);
+              word.clear();
+              while (std::isalpha((unsigned char) s.peek())) word += (char) s.get();
+              if (word != "row" && word != "column") {
+                on_error("Expected row or column after update but found: ", word.empty() ? s.peek() : word[0]);
                 return 1;
               }
+              d.kind = (word == "row") ? update_row : update_column;
+            } else if (word != "rhs") {
+              on_error("Expected a directive (rhs, update) but found: ", word[0]);
+              return 1;
+            }
+
+            if (!expect_ws_to_num(s) || !std::isdigit((unsigned char) s.peek())) {
+              on_error((d.kind == rhs_block) ? "Expected to read the number of right hand sides but found: " :
+                  "Expected to read the index to update but found: ", s.peek());
+              return 1;
+            }
+
+            s >> d.count;
+            if (d.kind == rhs_block && d.count < 1) {
+              on_error("Expected at least one right hand side but found: ", '0');
+              return 1;
+            }
+            if (d.kind == rhs_block && d.count > MAX_ORDER) {
+              on_error("Expected at most " + std::to_string(MAX_ORDER) + " right hand sides but found: ", s.peek());
+              return 1;
+            }
+            if (d.kind != rhs_block && d.count >= current_size) {
+              on_error("Expected an index below the order of the matrix but found: ", s.peek());
+              return 1;
+            }
+
+            if (!expect_wscr_to_num(s, current_size > 0)) {
+              on_error(
+                  "Expected to find whitespace or newlines until numeric on next line but found:", 
+                  s.peek());
+              return 1;
             }
 
-            std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            );
-            T det = compute(current_size, m);
-            std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            );
+            // the right hand sides by rows, an update as one line of n values
+            const int block_rows = (d.kind == rhs_block) ? current_size : 1;
+            const int block_cols = (d.kind == rhs_block) ? d.count : current_size;
+            block.resize(0, block_cols);
+            if (!read_block(block, block_rows, block_cols)) return 1;
 
-            report(o, current_size, m, det, end - start);
+            if (!on_directive(d, block)) return 0;
 
             current_state = wait;
             break;
+          }
         }
       }
 
       return 0;
     }
 
+  /**
+   * parse_matrices without directives.
+   */
+  template<typename T, typename In, typename OnMatrix, typename OnError>
+    int parse_matrices(In &s, OnMatrix on_matrix, OnError on_error) {
+      return parse_matrices<T>(s, on_matrix, on_error, no_directives());
+    }
+
+  /**
+   * read_matrices parses the input stream with parse_matrices, computes the determinant
+   * of every matrix and reports it as soon as it has been read. The first invalid input
+   * stops processing with an error report on the output stream.
+   *
+   * @param s - the input stream containing the matrix data to read.
+   * @param o - the output stream to write the result data to.
+   * @param compute - a function capable of computing the determinant for a given matrix.
+   * @param report - a reporting function that can format the result in a pleasing manner.
+   *
+   * The determinant has the type R, the type of the matrix values unless an engine
+   * returns something wider (see BigInt).
+   *
+   * @return an overall status, 0 being success and non-zero signaling failure.
+   */
+  template<typename T, typename R = T, typename In>
+    int read_matrices(
+        In &s, 
+        std::ostream &o,
+        typename identity<std::function<R(const Matrix<T>&)>>::type compute, 
+        typename identity<std::function<void(std::ostream &o, const Matrix<T>&, const R, std::chrono::milliseconds)>>::type report) {
+
+      static_assert(is_matrix_value<T>::value, "Matrix value type is required.");
+
+      // the matrix is done with once reported, its storage is reused for the next one
+      auto compute_and_report = [&](Matrix<T> &m) {
+        std::chrono::milliseconds start = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+        R det = compute(m);
+        std::chrono::milliseconds end = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+
+        report(o, m, det, end - start);
+        return true;
+      };
+
+      auto report_error = [&](const std::string &msg, const char &badc) {
+        reportError(o, msg, badc);
+      };
+
+      return parse_matrices<T>(s, compute_and_report, report_error);
+    }
+
   /**
    * given a matrix and a row and column index, produce the minor for that index.
    *
-   * @param size - the size of the source matrix
    * @param m - the matrix to compute the minor from
    * @param r - the row index (from 0)
    * @param c - the column index (from 0)
    * @return the minor/cofactor for the given index.
    */
   template<typename T>
-    std::unique_ptr<T[]> minor(const int size, const std::unique_ptr<T[]> &m, int r, int c) {
+    Matrix<T> minor(const Matrix<T> &m, int r, int c) {
       static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
 
-      int sz = size - 1;
-      auto mi = std::make_unique<T[]>(sz*sz);
+      const int size = m.order();
+      Matrix<T> mi(size - 1);
 
       int x = 0; 
 
       for (int i=0; i < size; i++) {
         if (i == r) continue;
+        int y = 0;
         for (int j=0; j < size; j++) {
           if (j == c) continue;
 
-          mi[x] = m[(i*size)+j]; 
-          x++;
+          mi(x, y) = m(i, j); 
+          y++;
         }
+        x++;
       }
 
       return mi;
     }
 
+  /**
+   * The recursive step of computeDeterminant. The sub-matrix being expanded is never
+   * copied, it is described by the k rows (rws) and k columns (cls) of the original
+   * matrix m that are still in play. Each level expands along whichever of those
+   * rows or columns holds the most zeros, as every zero is a whole branch of the
+   * recursion that never has to be visited.
+   *
+   * @param m - the original matrix data.
+   * @param ld - the row stride of the original matrix.
+   * @param k - the order of the sub-matrix.
+   * @param rws - the rows of the sub-matrix, ascending.
+   * @param cls - the columns of the sub-matrix, ascending.
+   * @param scratch - room for the index lists of the deeper levels, k * (k - 1) ints.
+   * @return the determinant of the sub-matrix.
+   */
+  template<typename T>
+    T cofactorExpansion(const T *m, const int ld, const int k, const int *rws, const int *cls, int *scratch) {
+      if (k == 1) return m[(ld * rws[0]) + cls[0]];
+
+      // bottom out at size = 2 b/c it is easy to compute.
+      if (k == 2) {
+        const T *r0 = m + (ld * rws[0]), *r1 = m + (ld * rws[1]);
+        return (r1[cls[1]] * r0[cls[0]]) - (r0[cls[1]] * r1[cls[0]]);
+      }
+
+      // pick the sparsest line, rows first so a dense matrix expands along its first row
+      int line = 0, most = -1;
+      bool by_row = true;
+      for (int i=0; i < k; i++) {
+        const T *r = m + (ld * rws[i]);
+        int zeros = 0;
+        for (int j=0; j < k; j++) zeros += (r[cls[j]] == 0);
+        if (zeros > most) { most = zeros; line = i; }
+      }
+      for (int j=0; j < k; j++) {
+        int zeros = 0;
+        for (int i=0; i < k; i++) zeros += (m[(ld * rws[i]) + cls[j]] == 0);
+        if (zeros > most) { most = zeros; line = j; by_row = false; }
+      }
+
+      if (most == k) return 0; // a line of zeros
+
+      // the fixed line drops out of one index list for every term
+      int *child_rws = scratch, *child_cls = scratch + (k - 1), *deeper = scratch + (2 * (k - 1));
+      const int *fixed = by_row ? rws : cls;
+      const int *other = by_row ? cls : rws;
+      int *child_fixed = by_row ? child_rws : child_cls;
+      int *child_other = by_row ? child_cls : child_rws;
+
+      for (int i=0, x=0; i < k; i++) {
+        if (i != line) child_fixed[x++] = fixed[i];
+      }
+
+      T sum = 0;
+      for (int j=0; j < k; j++) {
+        T v = by_row ? m[(ld * fixed[line]) + other[j]] : m[(ld * other[j]) + fixed[line]];
+        if (v == 0) continue; // skip
+
+        for (int i=0, x=0; i < k; i++) {
+          if (i != j) child_other[x++] = other[i];
+        }
+
+        T term = v * cofactorExpansion(m, ld, k - 1, child_rws, child_cls, deeper);
+        sum += ((line + j) % 2 == 0) ? term : -term;
+      }
+
+      return sum;
+    }
+
   /**
    * Recursively computes the determinant of a given matrix. Given a matrix of size N
    * this will operate at O(n!). The reason is that for any matrix we perform an operation
    * for each row or column and then for each one of those we do the same at the matrix of
    * size N-1. This defines the factorial function N*N-1*N-2*...N-(N-1). Technically, we 
    * operate at O(n!/2). The runtime is future influenced by the number of zeros in 
-   * the source matrix, the more zeros the shorter the runtime.
+   * the source matrix, the more zeros the shorter the runtime, which is why each level
+   * expands along its sparsest row or column (see cofactorExpansion). The recursion works
+   * on lists of row and column indices into the original matrix, the only allocation is
+   * a single scratch buffer for those lists. Orders 2 to 8 go to fixedCofactor, which does
+   * the same expansion without any allocation.
    *
-   * @param size - The size of the starting matrix to compute.
    * @param matrix - The matrix data.
    * @return the determinant for the given matrix.
    */
   template<typename T> 
-    T computeDeterminant(const int size, const std::unique_ptr<T[]> &matrix)  {
+    T computeDeterminant(const Matrix<T> &matrix)  {
       static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
 
-      std::function<T(const int, const std::unique_ptr<T[]>&)> det;
-      int i = 0; // lock to first row as it will always exist
-      
-      det = [&](const int sz, const std::unique_ptr<T[]> &m)->T {
+      const int size = matrix.order();
+      if (size < 1) return 0;
 
-        if (sz == 1) return m[0];
+      // small orders have a kernel of their own (see fixed.h)
+      T det;
+      if (fixedOrder(size, [&](auto order) { return fixedCofactor<T, decltype(order)::value>(matrix.data(), matrix.stride()); }, det)) return det;
 
-        // additional stopping case -- 
-        // bottom out at size = 2 b/c it is easy to compute.
-        if (sz == 2) return (m[3] * m[0]) - (m[1] * m[2]);
+      // the top level index lists, then k * (k - 1) for the levels below
+      std::vector<int> idx((2 * size) + (size * (size - 1)));
+      for (int i=0; i < size; i++) idx[i] = idx[size + i] = i;
 
-        T sum = 0;
+      return cofactorExpansion(matrix.data(), matrix.stride(), size, idx.data(), idx.data() + size, idx.data() + (2 * size));
+    }
 
-        for (int j=0; j<sz; j++) {
-          if (m[(sz * i) + j] == 0) continue; // skip
-          sum += pow(-1, (i + j)) * m[(sz * i) + j] * det(sz-1, deter::minor(sz, m, i, j));
+  /**
+   * Factors the n x n row-major matrix a (leading dimension lda) in place into L and U
+   * using Gaussian elimination with partial pivoting. On return the strict lower triangle
+   * holds the multipliers of L (unit diagonal implied) and the upper triangle holds U.
+   * The row swapped into position k is recorded in piv[k].
+   *
+   * A column without a non-zero pivot is left as is, the matrix is singular and the
+   * zero on the diagonal of U will carry that through to the determinant.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data, overwritten by the factors.
+   * @param lda - the distance between the start of consecutive rows.
+   * @param piv - receives the pivot row chosen for each column (n entries).
+   * @return the sign of the row permutation, 1 or -1.
+   */
+  template<typename F>
+    int factorLU(const int n, F *a, const int lda, int *piv) {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      int sign = 1;
+      for (int k=0; k < n; k++) {
+        // pick the largest magnitude in the column to keep the multipliers <= 1
+        int p = k;
+        F best = std::abs(a[(lda * k) + k]);
+        for (int i=k+1; i < n; i++) {
+          F v = std::abs(a[(lda * i) + k]);
+          if (v > best) { best = v; p = i; }
         }
 
-        return sum;
-      };
+        piv[k] = p;
+        if (best == 0) continue; // nothing to eliminate
+
+        if (p != k) {
+          std::swap_ranges(a + (lda * k), a + (lda * k) + n, a + (lda * p));
+          sign = -sign;
+        }
+
+        const F *rk = a + (lda * k);
+        for (int i=k+1; i < n; i++) {
+          F *ri = a + (lda * i);
+          F l = ri[k] / rk[k];
+          ri[k] = l;
+          if (l == 0) continue;
+          eliminate(n - k - 1, l, rk + k + 1, ri + k + 1);
+        }
+      }
+
+      return sign;
+    }
+
+  /**
+   * Width of the column panels factored by factorBlockedLU. A panel of this many columns
+   * and the block of U to its right are what the trailing update streams over.
+   */
+  const int BLOCK_SIZE = 64;
+
+  /**
+   * Number of trailing columns updated at once by factorBlockedLU. One tile of U
+   * (BLOCK_SIZE x TILE_COLS) is kept hot in L2 while every row below the panel is updated.
+   */
+  const int TILE_COLS = 256;
+
+  /**
+   * A blocked, right looking variant of factorLU producing the same factors with the same
+   * pivoting. The matrix is processed in panels of nb columns: the panel is factored with
+   * partial pivoting, the block row of U to its right is found with a triangular solve and
+   * the trailing matrix is then updated as a matrix product A22 -= L21 * U12. The product
+   * is done in tiles of TILE_COLS columns so the working set stays in cache, which is what
+   * keeps large orders from being memory bound.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data, overwritten by the factors.
+   * @param lda - the distance between the start of consecutive rows.
+   * @param piv - receives the pivot row chosen for each column (n entries).
+   * @param nb - the panel width.
+   * @return the sign of the row permutation, 1 or -1.
+   */
+  template<typename F>
+    int factorBlockedLU(const int n, F *a, const int lda, int *piv, const int nb = BLOCK_SIZE) {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      int sign = 1;
+      for (int k0=0; k0 < n; k0 += nb) {
+        const int k1 = std::min(k0 + nb, n); // panel is columns [k0, k1)
+
+        // factor the panel, swapping whole rows so the trailing columns follow the pivots
+        for (int k=k0; k < k1; k++) {
+          int p = k;
+          F best = std::abs(a[(lda * k) + k]);
+          for (int i=k+1; i < n; i++) {
+            F v = std::abs(a[(lda * i) + k]);
+            if (v > best) { best = v; p = i; }
+          }
+
+          piv[k] = p;
+          if (best == 0) continue;
+
+          if (p != k) {
+            std::swap_ranges(a + (lda * k), a + (lda * k) + n, a + (lda * p));
+            sign = -sign;
+          }
+
+          const F *rk = a + (lda * k);
+          for (int i=k+1; i < n; i++) {
+            F *ri = a + (lda * i);
+            F l = ri[k] / rk[k];
+            ri[k] = l;
+            if (l == 0) continue;
+            eliminate(k1 - k - 1, l, rk + k + 1, ri + k + 1);
+          }
+        }
+
+        if (k1 == n) break;
+
+        // U12 = L11^-1 * A12, a forward substitution over the rows of the panel
+        for (int r=k0+1; r < k1; r++) {
+          F *rr = a + (lda * r);
+          for (int q=k0; q < r; q++) {
+            F l = rr[q];
+            if (l == 0) continue;
+            eliminate(n - k1, l, a + (lda * q) + k1, rr + k1);
+          }
+        }
+
+        // A22 -= L21 * U12 one column tile at a time. Four rows of U12 are folded into
+        // each pass over a row of A22 so it is loaded and stored a quarter as often.
+        for (int j0=k1; j0 < n; j0 += TILE_COLS) {
+          const int j1 = std::min(j0 + TILE_COLS, n);
+          for (int i=k1; i < n; i++) {
+            F *ri = a + (lda * i);
+            int q = k0;
+            for (; q + 4 <= k1; q += 4) {
+              const F *r0 = a + (lda * q) + j0;
+              eliminate4(j1 - j0, ri + q, r0, r0 + lda, r0 + (2 * lda), r0 + (3 * lda), ri + j0);
+            }
+            for (; q < k1; q++) {
+              F l = ri[q];
+              if (l == 0) continue;
+              eliminate(j1 - j0, l, a + (lda * q) + j0, ri + j0);
+            }
+          }
+        }
+      }
 
-      return det(size, matrix);
+      return sign;
+    }
+
+  /**
+   * The shared driver for the elimination engines: factors a working copy of the matrix
+   * with the given factorization and multiplies out the diagonal of U. Integer matrices
+   * are factored in double and the result rounded to the nearest integer.
+   *
+   * @param matrix - The matrix data.
+   * @param factor - factorLU, factorBlockedLU or anything with their signature.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T, typename Factor>
+    T eliminationDeterminant(const Matrix<T> &matrix, Factor factor) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+      const int size = matrix.order();
+      if (size < 1) return 0;
+
+      // the copy is aligned with padded rows, whatever the layout of the input
+      Matrix<F> a(size);
+      a.assign(matrix);
+      std::vector<int> piv(size);
+
+      F det = factor(size, a.data(), a.stride(), piv.data());
+      for (int k=0; k < size; k++) det *= a(k, k);
+      if (det == 0) det = 0; // no negative zero in the report
+
+      if (std::is_integral<T>::value) return static_cast<T>(std::llround(det));
+      return static_cast<T>(det);
+    }
+
+  /**
+   * Computes the determinant using an LU decomposition with partial pivoting. This
+   * operates at O(n^3) so it remains usable well beyond the orders computeDeterminant
+   * can handle, at the price of floating point rounding in the result. Orders 2 to 8 go to
+   * fixedLU.
+   *
+   * @param matrix - The matrix data.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T>
+    T computeDeterminantLU(const Matrix<T> &matrix) {
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+      T det;
+      if (fixedOrder(matrix.order(), [&](auto order) { return fixedLU<T, decltype(order)::value>(matrix.data(), matrix.stride()); }, det)) return det;
+      return eliminationDeterminant(matrix, &factorLU<F>);
+    }
+
+  /**
+   * Computes the determinant with the cache blocked factorBlockedLU. Same O(n^3) and the
+   * same pivots as computeDeterminantLU, but much closer to peak throughput once the
+   * matrix no longer fits in cache (orders of a few hundred and up).
+   *
+   * @param matrix - The matrix data.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T>
+    T computeDeterminantBlocked(const Matrix<T> &matrix) {
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+      return eliminationDeterminant(matrix, [](const int n, F *a, const int lda, int *piv) {
+          return factorBlockedLU(n, a, lda, piv);
+      });
+    }
+
+  /**
+   * Appends the rows of a matrix to a report, each as "\n| 1 2 3 |" with the values right
+   * aligned to the width of the widest.
+   */
+  template<typename T>
+    void appendMatrix(report_scratch &s, const Matrix<T> &m, const int precision) {
+      s.values.clear();
+      s.lengths.clear();
+
+      // the width of the widest value, and the text of every value, in one pass
+      int maxlen = -1;
+      for (int r=0; r < m.rows(); r++) {
+        const T *row = m.row(r);
+        for (int c=0; c < m.cols(); c++) {
+          const int width = trimmedWidth(row[c]);
+          if (maxlen < width) maxlen = width;
+
+          const size_t before = s.values.size();
+          appendValue(s.values, row[c], precision);
+          s.lengths.push_back((unsigned char) (s.values.size() - before));
+        }
+      }
+
+      const char *value = s.values.data();
+      size_t i = 0;
+      for (int j=0; j < m.rows(); j++) {
+        s.text += "\n| ";
+        for (int k=0; k < m.cols(); k++) {
+          const int len = s.lengths[i++];
+          if (len < maxlen) s.text.append(maxlen - len, ' ');
+          s.text.append(value, len);
+          s.text += ' ';
+          value += len;
+        }
+        s.text += '|';
+      }
+    }
+
+  /**
+   * Appends the determinant to a report. A determinant that is not arithmetic is
+   * streamed, after writing out the report so far.
+   */
+  template<typename R>
+    void reportValue(std::ostream &outs, std::string &text, const R &deter, const int precision) {
+      if constexpr (is_formattable<R>::value) {
+        appendValue(text, deter, precision);
+      } else {
+        outs.write(text.data(), text.size());
+        outs << deter;
+        text.clear();
+      }
+    }
+
+  /**
+   * Appends the determinant and the time to a report.
+   */
+  template<typename R>
+    void reportTail(std::ostream &outs, std::string &text, const R &deter, std::chrono::milliseconds ms, const int precision) {
+      reportValue(outs, text, deter, precision);
+      text += '(';
+      appendValue(text, ms.count(), precision);
+      text += "ms)";
     }
 
   /**
@@ -263,48 +800,79 @@ namespace deter {
    * matrix and the computed determinant and outputting to the supplied stream. The formatting
    * is minimal and wholly contained in this function.
    *
+   * Arithmetic matrices are formatted with std::to_chars in one pass that also finds the
+   * column width, into buffers reused from report to report, and written with a single
+   * write. The stream is not flushed, give it a large buffer (OUTPUT_BUFFER).
+   *
    * @param outs - the stream to output the result to.
-   * @param size - the order of the matrix
    * @param m - the matrix that was computed
-   * @param deter - the determinant for the matrix
+   * @param deter - the determinant for the matrix, of any type that can be streamed
    */
-  template<typename T> 
-    void reportResult(std::ostream &outs, const int size, const std::unique_ptr<T[]> &m, const T deter, std::chrono::milliseconds ms) {
-      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
-
-      /** 
-       * utility used for sizing output, get the max width of any value in the matrix x
-       */
-      auto maxw = [](const int sz, const std::unique_ptr<T[]> &x) {
-        int max = -1;
-        char buf[16];
-        for (int i=0; i<(sz*sz); i++) {
-          // strange c++, is getting the min len actually this hard?
-          // https://stackoverflow.com/a/13709929
-          std::string str = std::to_string(x[i]);
-          str.erase ( str.find_last_not_of('0') + 1, std::string::npos );
-          str.erase ( str.find_last_not_of('.') + 1, std::string::npos );
-          int len = str.size();
-          
-          if (max < len) max = len;    
+  template<typename T, typename R = T> 
+    void reportResult(std::ostream &outs, const Matrix<T> &m, const R deter, std::chrono::milliseconds ms) {
+      static_assert(is_matrix_value<T>::value, "Matrix value type is required.");
+
+      const int size = m.order();
+
+      if constexpr (!is_formattable<T>::value) {
+        // other value types print through their own to_string and stream operators
+        int maxlen = -1;
+        for (int i=0; i < size; i++) {
+          for (int j=0; j < size; j++) {
+            using std::to_string;
+            std::string str = to_string(m(i, j));
+            str.erase ( str.find_last_not_of('0') + 1, std::string::npos );
+            str.erase ( str.find_last_not_of('.') + 1, std::string::npos );
+            if (maxlen < (int) str.size()) maxlen = str.size();
+          }
         }
 
-        return max;
-      };
-
-      int maxlen = maxw(size, m);
-
-      outs << "Given Matrix (M size: " << size << "):";
-      int i = 0;
-      for (int j=0; j < size; j++) {
-        outs << "\n| ";
-        for (int k=0; k < size; k++) {
-          outs << std::setw(maxlen) << m[(size * j) + k] << " " ;  
+        outs << "Given Matrix (M size: " << size << "):";
+        for (int j=0; j < size; j++) {
+          outs << "\n| ";
+          for (int k=0; k < size; k++) {
+            outs << std::setw(maxlen) << m(j, k) << " " ;  
+          }
+          outs << "|";  
         }
-        outs << "|";  
+        outs << " = det(M) = " << deter << "(" << ms.count() << "ms)" << std::endl << std::endl;
+      } else {
+        report_scratch &s = reportScratch();
+        const int precision = (int) outs.precision();
+
+        s.text += "Given Matrix (M size: ";
+        appendValue(s.text, size, precision);
+        s.text += "):";
+        appendMatrix(s, m, precision);
+        s.text += " = det(M) = ";
+
+        reportTail(outs, s.text, deter, ms, precision);
+        s.text += "\n\n";
+        outs.write(s.text.data(), s.text.size());
       }
-      
-      outs << " = det(M) = " << deter << "(" << ms.count() << "ms)" << std::endl << std::endl;
+    }
+
+  /**
+   * reportSummary reports only the order of the matrix and its determinant, for runs
+   * where echoing the matrix would dwarf the results.
+   *
+   * @param outs - the stream to output the result to.
+   * @param m - the matrix that was computed
+   * @param deter - the determinant for the matrix, of any type that can be streamed
+   */
+  template<typename T, typename R = T> 
+    void reportSummary(std::ostream &outs, const Matrix<T> &m, const R deter, std::chrono::milliseconds ms) {
+      static_assert(is_matrix_value<T>::value, "Matrix value type is required.");
+
+      report_scratch &s = reportScratch();
+      const int precision = (int) outs.precision();
+      s.text += "Given Matrix (M size: ";
+      appendValue(s.text, m.order(), precision);
+      s.text += ") = det(M) = ";
+
+      reportTail(outs, s.text, deter, ms, precision);
+      s.text += '\n';
+      outs.write(s.text.data(), s.text.size());
     }
 
 }
@@ -4,9 +4,27 @@
 #include <sstream>
 #include <iostream>
 #include <chrono>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
 
 #include "test_data.h"
 #include "deter.h"
+#include "tiled.h"
+#include "batch.h"
+#include "exact.h"
+#include "decimal.h"
+#include "mapped.h"
+#include "chunked.h"
+#include "binary.h"
+#include "aio.h"
+#include "lanes.h"
+#include "structure.h"
+#include "sparse.h"
+#include "btf.h"
+#include "filter.h"
+#include "factor.h"
+#include "cache.h"
 
 /**
  * The tests for the deter application. A simple set of tests for the
@@ -24,15 +42,15 @@ TEST(DeterTest, ReadMatrix) {
   int val[] = {5, 9, 4, 5, 5, 5, 5, 1};
   double det[] = {5, 3, 64, 270, 0, 270, 0, 0};
 
-  auto compute = [&](const int order, const std::unique_ptr<int[]> &m)  {
-    EXPECT_EQ(order, sz[i]);
-    EXPECT_EQ(m[order*order - 1], val[i]);
+  auto compute = [&](const deter::Matrix<int> &m)  {
+    EXPECT_EQ(m.order(), sz[i]);
+    EXPECT_EQ(m(m.order() - 1, m.order() - 1), val[i]);
     i++;
 
     return 1;
   };
 
-  auto report = [&](std::ostream &outs, const int size, const std::unique_ptr<int[]> &m, const int det, std::chrono::milliseconds ms) {
+  auto report = [&](std::ostream &outs, const deter::Matrix<int> &m, const int det, std::chrono::milliseconds ms) {
     // no op
   };
 
@@ -56,11 +74,11 @@ TEST(DeterTest, ParseInvalidData) {
   std::ostream os{&obuf};
   int result_count = 0;
 
-  auto compute = [&](const int order, const std::unique_ptr<int[]> &m)  {
+  auto compute = [&](const deter::Matrix<int> &m)  {
     return 1;
   };
 
-  auto report = [&](std::ostream &outs, const int size, const std::unique_ptr<int[]> &m, const int det, std::chrono::milliseconds ms) {
+  auto report = [&](std::ostream &outs, const deter::Matrix<int> &m, const int det, std::chrono::milliseconds ms) {
     // expect 1 result 
     result_count++;
   };
@@ -72,20 +90,21 @@ TEST(DeterTest, ParseInvalidData) {
 
 TEST(DeterTest, CreateMinor) {
   // a 3x3 matrix
-  auto m = std::make_unique<int[]>(9);
-  for (int i=1; i<10; i++) m[i-1] = i;
+  deter::Matrix<int> m(3);
+  for (int i=1; i<10; i++) m((i-1) / 3, (i-1) % 3) = i;
 
-  auto mi = deter::minor(3, m, 1, 2);
+  auto mi = deter::minor(m, 1, 2);
+  ASSERT_EQ(mi.order(), 2);
 
   int x[] { 1, 2, 7, 8 };
   for (int i=0; i < 4; i++) {
-    EXPECT_EQ(mi[i], x[i]);
+    EXPECT_EQ(mi(i / 2, i % 2), x[i]);
   }
 
-  auto mi2 = deter::minor(3, m, 0, 1);
+  auto mi2 = deter::minor(m, 0, 1);
   int y[] { 4, 6, 7, 9 };
   for (int i=0; i < 4; i++) {
-    EXPECT_EQ(mi2[i], y[i]);
+    EXPECT_EQ(mi2(i / 2, i % 2), y[i]);
   }
 }
 
@@ -96,7 +115,7 @@ TEST(DeterTest, ComputeDeter) {
   int i = 0;
   int det[] = {5, 3, 64, 270, 0, 270, 0, 0};
 
-  auto report = [&](std::ostream &outs, const int size, const std::unique_ptr<int[]> &m, const int detv, std::chrono::milliseconds ms) {
+  auto report = [&](std::ostream &outs, const deter::Matrix<int> &m, const int detv, std::chrono::milliseconds ms) {
     EXPECT_EQ(detv, det[i]);
     i++;
   };
@@ -117,10 +136,1146 @@ TEST(DeterTest, ComputeRealDeter) {
   int result_count = 0;
 
 
-  auto report = [&](std::ostream &outs, const int size, const std::unique_ptr<double[]> &m, const double det, std::chrono::milliseconds ms) {
+  auto report = [&](std::ostream &outs, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) {
     EXPECT_DOUBLE_EQ(det, 87.99385499999996);
   };
 
   int result = deter::read_matrices<double>(is, os, &deter::computeDeterminant<double>, report);
   EXPECT_EQ(result, 0);
 }
+
+TEST(DeterTest, ComputeLUDeter) {
+
+  std::stringbuf sbuf {ALL_MATRIX};
+  std::istream is(&sbuf);
+  int i = 0;
+  int det[] = {5, 3, 64, 270, 0, 270, 0, 0};
+
+  auto report = [&](std::ostream &outs, const deter::Matrix<int> &m, const int detv, std::chrono::milliseconds ms) {
+    EXPECT_EQ(detv, det[i]);
+    i++;
+  };
+
+  deter::read_matrices<int>(is, std::cout, &deter::computeDeterminantLU<int>, report);
+  EXPECT_EQ(i, 8);
+}
+
+TEST(DeterTest, ComputeLURealDeter) {
+  // a row swap is required on the first column, the sign must follow it
+  deter::Matrix<double> m(3);
+  double x[] { -1, 5.999, 2, 3.45, -2.2, 4, -3, 6.7, 4.1 };
+  for (int i=0; i < 9; i++) m(i / 3, i % 3) = x[i];
+
+  EXPECT_NEAR(deter::computeDeterminantLU<double>(m), -87.99385499999996, 1e-10);
+  EXPECT_NEAR(deter::computeDeterminantLU<double>(m), deter::computeDeterminant<double>(m), 1e-10);
+}
+
+TEST(DeterTest, BlockedLUMatchesLU) {
+  // an order that is not a multiple of the panel width, with a small panel so that
+  // several panels and a partial trailing tile are exercised
+  const int n = 157;
+  std::vector<double> a(n * n), b;
+  std::srand(7);
+  for (auto &v : a) v = (std::rand() % 2001 - 1000) / 100.0;
+  b = a;
+
+  std::vector<int> pa(n), pb(n);
+  int sa = deter::factorLU(n, a.data(), n, pa.data());
+  int sb = deter::factorBlockedLU(n, b.data(), n, pb.data(), 16);
+
+  EXPECT_EQ(sa, sb);
+  EXPECT_EQ(pa, pb);
+  for (int i=0; i < n * n; i++) {
+    EXPECT_NEAR(a[i], b[i], 1e-9 * (1 + std::abs(a[i])));
+  }
+}
+
+TEST(DeterTest, VectorKernelsMatchScalar) {
+  // odd lengths so every kernel runs its remainder handling too
+  const int n = 37;
+  double l[4] = { 0.5, -1.25, 3, 0.125 };
+  std::vector<double> x(4 * n), y(n);
+  std::vector<float> xf(4 * n), yf(n);
+  for (int j=0; j < 4 * n; j++) { x[j] = (j % 11) - 5.5; xf[j] = (float) x[j]; }
+  for (int j=0; j < n; j++) { y[j] = j * 0.75; yf[j] = (float) y[j]; }
+
+  std::vector<double> ref = y, ref4 = y;
+  deter::eliminate<double>(n, l[0], x.data(), ref.data());
+  deter::eliminate4<double>(n, l, x.data(), x.data() + n, x.data() + 2 * n, x.data() + 3 * n, ref4.data());
+
+  deter::isa best = deter::detectIsa();
+  for (int level = deter::scalar; level <= best; level++) {
+    EXPECT_EQ(deter::useIsa((deter::isa) level), level);
+
+    std::vector<double> a = y, b = y;
+    std::vector<float> af = yf;
+    deter::eliminate(n, l[0], x.data(), a.data());
+    deter::eliminate4(n, l, x.data(), x.data() + n, x.data() + 2 * n, x.data() + 3 * n, b.data());
+    deter::eliminate(n, (float) l[0], xf.data(), af.data());
+
+    for (int j=0; j < n; j++) {
+      EXPECT_NEAR(a[j], ref[j], 1e-12) << deter::isaName((deter::isa) level);
+      EXPECT_NEAR(b[j], ref4[j], 1e-12) << deter::isaName((deter::isa) level);
+      EXPECT_NEAR(af[j], ref[j], 1e-4) << deter::isaName((deter::isa) level);
+    }
+  }
+
+  deter::useIsa(best);
+}
+
+TEST(DeterTest, TiledLUMatchesBlocked) {
+  const int n = 301;
+  std::vector<double> a(n * n), b;
+  std::srand(11);
+  for (auto &v : a) v = (std::rand() % 2001 - 1000) / 100.0;
+  b = a;
+
+  deter::ThreadPool pool(4);
+  std::vector<int> pa(n), pb(n);
+  int sa = deter::factorBlockedLU(n, a.data(), n, pa.data(), 32);
+  int sb = deter::factorTiledLU(n, b.data(), n, pb.data(), pool, 32);
+
+  EXPECT_EQ(sa, sb);
+  EXPECT_EQ(pa, pb);
+  for (int k=0; k < n; k++) {
+    EXPECT_NEAR(a[(n * k) + k], b[(n * k) + k], 1e-9 * (1 + std::abs(a[(n * k) + k])));
+  }
+}
+
+TEST(DeterTest, PoolRunsNestedWork) {
+  deter::ThreadPool pool(3);
+  std::atomic<long> sum { 0 };
+
+  // every outer task waits on an inner parallel_for from inside the pool
+  pool.parallel_for(0, 10, [&](long i) {
+      pool.parallel_for(0, 100, [&](long j) { sum += j; });
+  });
+
+  EXPECT_EQ(sum, 10 * 4950);
+}
+
+TEST(DeterTest, BatchKeepsInputOrder) {
+  // an error at the end must still come after every result before it
+  std::string input = std::string(ALL_MATRIX) + "2\n1 2\n3 4 5\n";
+
+  auto report = [](std::ostream &outs, const deter::Matrix<int> &m, const int det, std::chrono::milliseconds ms) {
+    outs << m.order() << ":" << det << "\n";
+  };
+
+  std::stringbuf sbuf {input}, bbuf {input};
+  std::istream is {&sbuf}, bs {&bbuf};
+  std::ostringstream serial, batch;
+
+  // uneven compute times so the workers finish out of order
+  auto slow = [](const deter::Matrix<int> &m) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(m.order() % 3));
+    return deter::computeDeterminant<int>(m);
+  };
+
+  int rs = deter::read_matrices<int>(is, serial, slow, report);
+  int rb = deter::read_matrices_batch<int>(bs, batch, slow, report, 4, 3);
+
+  EXPECT_EQ(rs, 1);
+  EXPECT_EQ(rb, rs);
+  EXPECT_EQ(batch.str(), serial.str());
+
+  // a parser that throws stops the threads cleanly, after the matrices before it
+  std::istringstream big("2\n1 2\n3 4\n1\n99999999999999999999\n");
+  std::vector<std::string> dets;
+  std::function<deter::Decimal(const deter::Matrix<deter::Fixed>&)> exact = &deter::computeDeterminantDecimal;
+  auto keep = [&](std::ostream &o, const deter::Matrix<deter::Fixed> &m, const deter::Decimal det, std::chrono::milliseconds ms) {
+    std::ostringstream d;
+    d << det;
+    dets.push_back(d.str());
+  };
+  EXPECT_THROW((deter::read_matrices_batch<deter::Fixed, deter::Decimal>(big, std::cout, exact, keep, 2)), std::exception);
+  EXPECT_EQ(dets, std::vector<std::string>({ "-2" }));
+}
+
+TEST(DeterTest, CofactorMatchesMinorExpansion) {
+  // the plain first row expansion over copied minors, as a reference
+  std::function<long(const deter::Matrix<long>&)> reference;
+  reference = [&](const deter::Matrix<long> &m)->long {
+    if (m.order() == 1) return m(0, 0);
+    long sum = 0;
+    for (int j=0; j < m.order(); j++) {
+      if (m(0, j) == 0) continue;
+      sum += ((j % 2) ? -1 : 1) * m(0, j) * reference(deter::minor(m, 0, j));
+    }
+    return sum;
+  };
+
+  std::srand(3);
+  for (int n=1; n <= 8; n++) {
+    deter::Matrix<long> m(n);
+    // roughly half zeros so the expansion picks all sorts of lines
+    for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 2) ? (std::rand() % 19) - 9 : 0;
+
+    EXPECT_EQ(deter::computeDeterminant<long>(m), reference(m)) << "order " << n;
+  }
+}
+
+TEST(DeterTest, CofactorHandlesLargeSparse) {
+  // lower bidiagonal: every level has a column with a single entry, far beyond
+  // anything a first row expansion could reach
+  const int n = 60;
+  deter::Matrix<double> m(n);
+  for (int i=0; i < n; i++) {
+    m(i, i) = (i % 3) ? 1 : -1;
+    if (i > 0) m(i, i - 1) = 7;
+  }
+
+  EXPECT_EQ(deter::computeDeterminant<double>(m), 1.0); // (-1)^20
+}
+
+TEST(DeterTest, DPMatchesCofactor) {
+  std::srand(5);
+  for (int n=1; n <= 9; n++) {
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 3) ? (std::rand() % 21) - 10 : 0;
+
+    EXPECT_EQ(deter::computeDeterminantDP<long>(m), deter::computeDeterminant<long>(m)) << "order " << n;
+  }
+
+  std::stringbuf sbuf {ALL_MATRIX};
+  std::istream is(&sbuf);
+  int i = 0;
+  int det[] = {5, 3, 64, 270, 0, 270, 0, 0};
+
+  auto report = [&](std::ostream &outs, const deter::Matrix<int> &m, const int detv, std::chrono::milliseconds ms) {
+    EXPECT_EQ(detv, det[i]);
+    i++;
+  };
+
+  deter::read_matrices<int>(is, std::cout, &deter::computeDeterminantDP<int>, report);
+  EXPECT_EQ(i, 8);
+}
+
+TEST(DeterTest, DPParallelLayers) {
+  const int n = 16;
+  deter::Matrix<long> m(n);
+  std::srand(8);
+  for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 7) - 3;
+
+  deter::ThreadPool pool(4);
+  long serial = deter::computeDeterminantDP<long>(m);
+  EXPECT_EQ(deter::determinantBySubsets<long>(m, &pool), serial);
+  EXPECT_EQ(deter::computeDeterminantLU<long>(m), serial);
+
+  deter::Matrix<long> big(26);
+  EXPECT_THROW(deter::computeDeterminantDP<long>(big), std::length_error);
+}
+
+TEST(DeterTest, BareissIsExact) {
+  std::srand(13);
+  for (int n=1; n <= 10; n++) {
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 4) ? (std::rand() % 61) - 30 : 0;
+
+    EXPECT_EQ(deter::computeDeterminantBareiss<long>(m), deter::computeDeterminantDP<long>(m)) << "order " << n;
+  }
+
+  // det = 10^6^4 = 10^24, beyond int64_t, mixed by adding multiples of rows
+  const int n = 4;
+  deter::Matrix<double> m(n);
+  for (int i=0; i < n; i++) {
+    for (int j=i; j < n; j++) m(i, j) = (i == j) ? 1000000 : (i + 2 * j);
+  }
+  for (int i=1; i < n; i++) {
+    for (int j=0; j < n; j++) m(i, j) += (i + 1) * m(0, j);
+  }
+  EXPECT_DOUBLE_EQ(deter::computeDeterminantBareiss<double>(m), 1e24);
+
+  for (int i=0; i < n; i++) m(i, i) *= 10000; // 10^40 does not fit 128 bits
+  EXPECT_THROW(deter::computeDeterminantBareiss<double>(m), std::overflow_error);
+
+  m(0, 1) = 0.5;
+  EXPECT_THROW(deter::computeDeterminantBareiss<double>(m), std::invalid_argument);
+}
+
+TEST(DeterTest, ModularIsExact) {
+  std::srand(21);
+  deter::ThreadPool pool(3);
+  for (int n=1; n <= 12; n++) {
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 4) ? (std::rand() % 2001) - 1000 : 0;
+
+    std::vector<__int128> wide;
+    deter::toInteger(m, wide);
+    __int128 det;
+    ASSERT_TRUE(deter::bareiss(n, wide.data(), det));
+
+    EXPECT_EQ(deter::computeDeterminantModular<long>(m), deter::BigInt(det)) << "order " << n;
+    EXPECT_EQ(deter::determinantByPrimes<long>(m, &pool), deter::computeDeterminantModular<long>(m)) << "order " << n;
+  }
+
+  // upper triangular with 10^9 on the diagonal and -1 in the last place: -10^261
+  const int n = 30;
+  deter::Matrix<double> m(n);
+  for (int i=0; i < n; i++) {
+    for (int j=i; j < n; j++) m(i, j) = (i == j) ? 1000000000 : (j - i);
+  }
+  m(n - 1, n - 1) = -1000;
+  for (int i=1; i < n; i++) {
+    for (int j=0; j < n; j++) m(i, j) -= i * m(0, j);
+  }
+  EXPECT_EQ(deter::determinantByPrimes<double>(m, &pool).toString(), "-1" + std::string(29 * 9 + 3, '0'));
+
+  m(2, 1) = 0.5;
+  EXPECT_THROW(deter::computeDeterminantModular<double>(m), std::invalid_argument);
+}
+
+TEST(DeterTest, DecimalModeIsExact) {
+  std::string input = "2\n0.1 0.2\n0.3 0.4\n3\n1.5 -2 0.25\n3 4.75 -1\n-0.5 2 1e1\n1\n-0.30\n";
+  std::vector<std::string> dets;
+  std::vector<std::string> firsts;
+
+  std::function<void(std::ostream&, const deter::Matrix<deter::Fixed>&, const deter::Decimal, std::chrono::milliseconds)> report =
+    [&](std::ostream &o, const deter::Matrix<deter::Fixed> &m, const deter::Decimal det, std::chrono::milliseconds ms) {
+      std::ostringstream d, f;
+      d << det;
+      f << m(0, 0);
+      dets.push_back(d.str());
+      firsts.push_back(f.str());
+    };
+
+  std::istringstream is(input);
+  int result = deter::read_matrices<deter::Fixed, deter::Decimal>(is, std::cout, &deter::computeDeterminantDecimal, report);
+
+  EXPECT_EQ(result, 0);
+  ASSERT_EQ(dets.size(), 3u);
+  EXPECT_EQ(dets[0], "-0.02"); // 0.04 - 0.06, which double gets wrong
+  EXPECT_EQ(dets[1], "135.34375");
+  EXPECT_EQ(dets[2], "-0.3");
+  EXPECT_EQ(firsts[0], "0.1");
+  EXPECT_EQ(deter::to_string(deter::Fixed { -30, 2 }), "-0.30");
+}
+
+TEST(DeterTest, BufferInputMatchesStream) {
+  // everything the parser saw, in order
+  auto trace = [](auto &in) {
+    std::ostringstream t;
+    int result = deter::parse_matrices<double>(in,
+        [&](deter::Matrix<double> &m) {
+          t << "M" << m.order() << ":";
+          for (int i=0; i < m.order() * m.order(); i++) t << std::hexfloat << m(i / m.order(), i % m.order()) << ",";
+          return true;
+        },
+        [&](const std::string &msg, const char &badc) { t << "E" << msg << (int) badc; });
+    t << "R" << result;
+    return t.str();
+  };
+
+  std::vector<std::string> inputs = { ALL_MATRIX, WILD_MATRIX, ERR_MATRIX, RANDOM_MATRIX, REAL_MATRIX,
+    "", "\n\n", "2\n1 2\n3 4", "2\n1 2\n3 4\n\n\n1\n-" };
+
+  // mutations of valid input plus noise, over the characters that matter to the grammar
+  const char alphabet[] = "0123456789-+.eE \t\r\nx";
+  std::srand(11);
+  const size_t seeds = inputs.size();
+  for (int k=0; k < 3000; k++) {
+    std::string s = inputs[std::rand() % seeds];
+    int edits = 1 + (std::rand() % 4);
+    for (int e=0; e < edits && !s.empty(); e++) {
+      size_t at = std::rand() % s.size();
+      char c = alphabet[std::rand() % (sizeof(alphabet) - 1)];
+      switch (std::rand() % 3) {
+        case 0: s[at] = c; break;
+        case 1: s.insert(s.begin() + at, c); break;
+        default: s.erase(at, 1); break;
+      }
+    }
+    if (k % 10 == 0) s = s.substr(0, std::rand() % (s.size() + 1));
+    inputs.push_back(s);
+  }
+  inputs.push_back("1\n1e400\n1\n-1e-400\n1\n0x5\n1\n+.5e+2\n1\n99999999999999999999\n");
+
+  // orders the input does not back up are not allocated up front
+  inputs.push_back("620152\n1 2\n");
+  inputs.push_back("1048576\n1\n");
+  inputs.push_back("1048577\n1\n");
+  inputs.push_back("2147483647\n1\n");
+  inputs.push_back("1\n2\nrhs 99999999\n1\n");
+
+  for (const std::string &s : inputs) {
+    std::istringstream is(s);
+    deter::BufferInput bi(s.data(), s.data() + s.size());
+    ASSERT_EQ(trace(bi), trace(is)) << "input: " << s;
+  }
+}
+
+TEST(DeterTest, ChunkedParseMatchesSerial) {
+  auto trace = [](auto &in) {
+    std::ostringstream t;
+    int result = deter::parse_matrices<double>(in,
+        [&](deter::Matrix<double> &m) {
+          t << "M" << m.order() << ":";
+          for (int i=0; i < m.order() * m.order(); i++) t << m(i / m.order(), i % m.order()) << ",";
+          return true;
+        },
+        [&](const std::string &msg, const char &badc) { t << "E" << msg << (int) badc; });
+    t << "R" << result;
+    return t.str();
+  };
+
+  // 1 x 1 matrices make every row look like an order line
+  std::string ones;
+  for (int i=0; i < 200; i++) ones += "1\n" + std::to_string(i % 3) + "\n";
+
+  std::vector<std::string> inputs = { ALL_MATRIX, ones, ones + "2\n1 2\n3 x\n" + ones, "" };
+  std::srand(12);
+  std::string mixed;
+  for (int i=0; i < 300; i++) {
+    int n = 1 + (std::rand() % 5);
+    mixed += std::to_string(n) + ((i % 7) ? "\n" : " \n\n");
+    for (int r=0; r < n; r++) {
+      for (int c=0; c < n; c++) mixed += std::to_string((std::rand() % 19) - 9) + ((c + 1 < n) ? " " : "\n");
+    }
+  }
+  inputs.push_back(mixed);
+  for (int k=0; k < 40; k++) {
+    std::string s = mixed;
+    s[std::rand() % s.size()] = "0123456789- \n."[std::rand() % 14];
+    inputs.push_back(s);
+  }
+
+  deter::ThreadPool pool(3);
+  for (const std::string &s : inputs) {
+    std::istringstream is(s);
+    const std::string serial = trace(is);
+    for (size_t chunk : { 1, 7, 64, 1000 }) {
+      deter::ChunkedInput in(s.data(), s.data() + s.size(), pool, chunk);
+      ASSERT_EQ(trace(in), serial) << "chunk " << chunk << " input: " << s;
+    }
+  }
+}
+
+TEST(DeterTest, BinaryContainerRoundTrip) {
+  std::ostringstream bin;
+  deter::BinaryWriter writer(bin);
+  std::istringstream is(ALL_MATRIX);
+  std::vector<double> expected;
+  deter::parse_matrices<double>(is,
+      [&](deter::Matrix<double> &m) {
+        writer.add(m);
+        expected.push_back(deter::computeDeterminant(m));
+        return true;
+      },
+      [](const std::string &msg, const char &badc) { FAIL() << msg; });
+  writer.finish();
+
+  // copy into 64 byte aligned memory, as a mapping would be
+  const std::string bytes = bin.str();
+  std::unique_ptr<double[]> storage(new double[(bytes.size() / 8) + 8]);
+  char *first = (char*) (((uintptr_t) storage.get() + 63) & ~(uintptr_t) 63);
+  std::copy(bytes.begin(), bytes.end(), first);
+
+  deter::BinaryInput in(first, first + bytes.size());
+  ASSERT_EQ(in.count(), expected.size());
+
+  std::vector<double> serial, batch;
+  bool in_place = true;
+  std::function<double(const deter::Matrix<double>&)> compute =
+    [&](const deter::Matrix<double> &m) {
+      const char *p = (const char*) m.data();
+      in_place = in_place && !m.owner() && p > first && p < first + bytes.size() && ((uintptr_t) p % 64) == 0;
+      return deter::computeDeterminant(m);
+    };
+  deter::read_binary_matrices<double>(in, std::cout, compute,
+      [&](std::ostream &o, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) { serial.push_back(det); });
+  deter::read_matrices_batch<double>(in, std::cout, &deter::computeDeterminant<double>,
+      [&](std::ostream &o, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) { batch.push_back(det); }, 2);
+
+  EXPECT_TRUE(in_place) << "payloads are lent from the mapping";
+  EXPECT_EQ(serial, expected);
+  EXPECT_EQ(batch, expected);
+
+  // a damaged index is rejected, not read
+  ((deter::binary_header*) first)->index_offset += 8;
+  EXPECT_THROW(deter::BinaryInput(first, first + bytes.size()), std::runtime_error);
+  EXPECT_THROW(deter::BinaryInput(first + 1, first + bytes.size()), std::runtime_error);
+}
+
+TEST(DeterTest, AsyncStreamsRoundTrip) {
+  // enough text to wrap around the ring of small buffers many times
+  std::string text;
+  for (int i=0; i < 4000; i++) text += std::to_string(i * 7919) + ((i % 13) ? " " : "\n");
+  const std::string path = ::testing::TempDir() + "deter_async.txt";
+
+  for (bool uring : { true, false }) {
+    {
+      deter::AsyncWriter buffer(path.c_str(), 1000, 3, uring);
+      ASSERT_TRUE(buffer.is_open());
+      EXPECT_EQ(buffer.uring() && !uring, false);
+      std::ostream out(&buffer);
+      out << text << std::flush;
+      EXPECT_TRUE(buffer.close());
+    }
+
+    for (unsigned buffers : { 2u, 3u }) {
+      deter::AsyncReader buffer(path.c_str(), 1000, buffers, uring);
+      ASSERT_TRUE(buffer.is_open());
+      std::istream in(&buffer);
+      std::string read((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      EXPECT_EQ(read, text) << "uring " << uring << " buffers " << buffers;
+    }
+
+    // the parser reads the same matrices through it as through a file stream
+    {
+      std::ofstream(path) << ALL_MATRIX;
+      deter::AsyncReader buffer(path.c_str(), 16, 3, uring);
+      std::istream in(&buffer);
+      std::istringstream expected_in(ALL_MATRIX);
+      std::vector<double> got, expected;
+      deter::read_matrices<double>(in, std::cout, &deter::computeDeterminant<double>,
+          [&](std::ostream &o, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) { got.push_back(det); });
+      deter::read_matrices<double>(expected_in, std::cout, &deter::computeDeterminant<double>,
+          [&](std::ostream &o, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) { expected.push_back(det); });
+      EXPECT_FALSE(got.empty());
+      EXPECT_EQ(got, expected);
+    }
+  }
+
+  std::remove(path.c_str());
+  EXPECT_FALSE(deter::AsyncReader("/nonexistent/deter").is_open());
+}
+
+TEST(DeterTest, ReportMatchesStreamFormatting) {
+  // the stream based report the formatter replaced
+  auto reference = [](std::ostream &outs, const deter::Matrix<double> &m, const double det) {
+    const int size = m.order();
+    int maxlen = -1;
+    for (int i=0; i < size * size; i++) {
+      std::string str = std::to_string(m(i / size, i % size));
+      str.erase(str.find_last_not_of('0') + 1, std::string::npos);
+      str.erase(str.find_last_not_of('.') + 1, std::string::npos);
+      if (maxlen < (int) str.size()) maxlen = str.size();
+    }
+    outs << "Given Matrix (M size: " << size << "):";
+    for (int j=0; j < size; j++) {
+      outs << "\n| ";
+      for (int k=0; k < size; k++) outs << std::setw(maxlen) << m(j, k) << " ";
+      outs << "|";
+    }
+    outs << " = det(M) = " << det << "(" << 3 << "ms)" << std::endl << std::endl;
+  };
+
+  const double special[] = { 0.0, -0.0, 1e-7, -4.5e-7, 1234567.0, 100.0, -40.59, 1e308, -1e-308, 0.1, 2.5e-6,
+    std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 999999.5, 0.0000005 };
+  std::srand(15);
+  for (int trial=0; trial < 200; trial++) {
+    const int n = 1 + (trial % 6);
+    deter::Matrix<double> m(n);
+    for (int i=0; i < n * n; i++) {
+      double &v = m(i / n, i % n);
+      switch (std::rand() % 3) {
+        case 0: v = special[std::rand() % (sizeof(special) / sizeof(special[0]))]; break;
+        case 1: v = (std::rand() % 2001) - 1000; break;
+        default: v = std::ldexp((double) std::rand() - (RAND_MAX / 2), (std::rand() % 80) - 60); break;
+      }
+    }
+    const double det = m(0, 0) * 3.7;
+
+    std::ostringstream expected, got;
+    reference(expected, m, det);
+    deter::reportResult<double>(got, m, det, std::chrono::milliseconds(3));
+    ASSERT_EQ(got.str(), expected.str());
+  }
+
+  deter::Matrix<double> m(2);
+  m(0, 0) = 1; m(0, 1) = 2; m(1, 0) = 3; m(1, 1) = 4;
+  std::ostringstream summary;
+  deter::reportSummary<double>(summary, m, -2.0, std::chrono::milliseconds(1));
+  EXPECT_EQ(summary.str(), "Given Matrix (M size: 2) = det(M) = -2(1ms)\n");
+}
+
+TEST(DeterTest, FixedKernelsMatchGeneral) {
+  const deter::isa was = deter::kernelIsa();
+  deter::useIsa(deter::scalar);
+
+  std::srand(16);
+  for (int trial=0; trial < 500; trial++) {
+    const int n = deter::FIXED_MIN + (trial % (deter::FIXED_MAX - deter::FIXED_MIN + 1));
+    deter::Matrix<double> m(n);
+    deter::Matrix<long> l(n);
+    for (int i=0; i < n; i++) {
+      for (int j=0; j < n; j++) {
+        // zeros often enough to steer the expansion along other lines
+        l(i, j) = (std::rand() % 3 == 0) ? 0 : (std::rand() % 41) - 20;
+        m(i, j) = (trial % 2) ? l(i, j) : l(i, j) + ((std::rand() % 100) / 37.0);
+      }
+    }
+
+    std::vector<int> idx((2 * n) + (n * (n - 1)));
+    for (int i=0; i < n; i++) idx[i] = idx[n + i] = i;
+    const double general = deter::cofactorExpansion(m.data(), m.stride(), n, idx.data(), idx.data() + n, idx.data() + (2 * n));
+    const long general_int = deter::cofactorExpansion(l.data(), l.stride(), n, idx.data(), idx.data() + n, idx.data() + (2 * n));
+
+    EXPECT_EQ(deter::computeDeterminant(m), general) << "order " << n;
+    EXPECT_EQ(deter::computeDeterminant(l), general_int) << "order " << n;
+    EXPECT_EQ(deter::computeDeterminantLU(m), deter::eliminationDeterminant(m, &deter::factorLU<double>)) << "order " << n;
+    EXPECT_EQ(deter::computeDeterminantLU(l), deter::eliminationDeterminant(l, &deter::factorLU<double>)) << "order " << n;
+  }
+
+  deter::useIsa(was);
+}
+
+TEST(DeterTest, LanesMatchScalarLU) {
+  const deter::isa was = deter::kernelIsa();
+
+  // mixed orders with runs of each, singular matrices and zero columns among them
+  std::srand(17);
+  std::string input;
+  for (int i=0; i < 400; i++) {
+    const int n = (i / 9) % 10 + 1;
+    input += std::to_string(n) + "\n";
+    const int kind = std::rand() % 5;
+    for (int r=0; r < n; r++) {
+      for (int c=0; c < n; c++) {
+        double v = ((std::rand() % 2001) - 1000) / 64.0;
+        if (kind == 0 && c == 0) v = 0;
+        if (kind == 1) v = r + c;
+        input += std::to_string(v) + ((c + 1 < n) ? " " : "\n");
+      }
+    }
+  }
+
+  auto collect = [](std::vector<double> &dets) {
+    return [&dets](std::ostream &o, const deter::Matrix<double> &m, const double det, std::chrono::milliseconds ms) { dets.push_back(det); };
+  };
+
+  for (deter::isa level : { deter::scalar, deter::avx2, deter::avx512 }) {
+    if (deter::useIsa(level) != level) continue;
+
+    // orders 2 to 8 of computeDeterminantLU are the scalar loops whatever the isa
+    std::vector<double> expected;
+    std::istringstream expected_in(input);
+    deter::read_matrices<double>(expected_in, std::cout, &deter::computeDeterminantLU<double>, collect(expected));
+    ASSERT_EQ(expected.size(), 400u);
+
+    std::vector<double> got;
+    std::istringstream in(input);
+    deter::read_matrices_lanes(in, std::cout, &deter::computeDeterminantLU<double>, collect(got));
+    ASSERT_EQ(got.size(), expected.size());
+    for (size_t i=0; i < got.size(); i++) {
+      // bit for bit, so the sign of a zero counts
+      EXPECT_EQ(std::signbit(got[i]), std::signbit(expected[i])) << deter::isaName(level) << " matrix " << i;
+      EXPECT_EQ(got[i], expected[i]) << deter::isaName(level) << " matrix " << i;
+    }
+  }
+
+  deter::useIsa(was);
+}
+
+TEST(DeterTest, MatrixLayout) {
+  // short rows stay dense, long ones are padded to whole lines and off multiples of 4 KiB
+  EXPECT_EQ(deter::paddedStride<double>(5), 5);
+  EXPECT_EQ(deter::paddedStride<double>(9), 16);
+  EXPECT_EQ(deter::paddedStride<double>(512), 520);
+  EXPECT_EQ(deter::paddedStride<float>(1024), 1040);
+
+  // a cycle of length l is l - 1 swaps
+  EXPECT_EQ(deter::permutationSign({}), 1);
+  EXPECT_EQ(deter::permutationSign({0, 1, 2, 3}), 1);
+  EXPECT_EQ(deter::permutationSign({1, 0, 2, 3}), -1);
+  EXPECT_EQ(deter::permutationSign({1, 2, 0, 3}), 1);
+  EXPECT_EQ(deter::permutationSign({1, 2, 3, 0}), -1);
+  EXPECT_EQ(deter::permutationSign({1, 0, 3, 2}), 1);
+
+  deter::Matrix<double> m(100);
+  EXPECT_EQ(m.stride(), 104);
+  EXPECT_EQ((uintptr_t) m.data() % deter::MATRIX_ALIGN, 0u);
+  EXPECT_EQ((uintptr_t) m.row(37) % deter::MATRIX_ALIGN, 0u);
+
+  // the storage is kept for a smaller matrix, and zeroed
+  m(3, 3) = 1;
+  const double *data = m.data();
+  m.resize(40);
+  EXPECT_EQ(m.data(), data);
+  EXPECT_EQ(m(3, 3), 0);
+
+  // a block is a view with the stride of its parent, and computes like a copy of itself
+  std::srand(18);
+  for (int i=0; i < 40; i++) {
+    for (int j=0; j < 40; j++) m(i, j) = (std::rand() % 201) - 100;
+  }
+  deter::Matrix<double> block = m.block(5, 7, 20, 20);
+  EXPECT_FALSE(block.owner());
+  EXPECT_EQ(block.stride(), m.stride());
+  EXPECT_EQ(&block(0, 0), &m(5, 7));
+
+  deter::Matrix<double> copy(20);
+  copy.assign(block);
+  EXPECT_TRUE(copy.owner());
+  EXPECT_EQ(deter::computeDeterminantLU(block), deter::computeDeterminantLU(copy));
+  EXPECT_EQ(deter::computeDeterminantBlocked(block), deter::computeDeterminantBlocked(copy));
+  EXPECT_EQ(deter::computeDeterminantModular(block), deter::computeDeterminantModular(copy));
+
+  deter::Matrix<double> small = m.block(1, 2, 6, 6), small_copy(6);
+  small_copy.assign(small);
+  EXPECT_EQ(deter::computeDeterminant(small), deter::computeDeterminant(small_copy));
+  EXPECT_EQ(deter::computeDeterminantDP(small), deter::computeDeterminant(small_copy));
+
+  // the views of a const matrix are read only, and compute the same
+  const deter::Matrix<double> &fixed = m;
+  static_assert(std::is_same<decltype(fixed.block(0, 0, 1, 1)), deter::ConstView<double>>::value, "const block");
+  static_assert(std::is_same<decltype(fixed.view()), deter::ConstView<double>>::value, "const view");
+  static_assert(!std::is_constructible<deter::Matrix<double>, deter::ConstView<double>>::value, "no writable copy");
+  static_assert(!std::is_convertible<deter::ConstView<double>, deter::Matrix<double>&>::value, "no writable reference");
+  deter::ConstView<double> seen = fixed.block(5, 7, 20, 20);
+  EXPECT_EQ(&seen(0, 0), &m(5, 7));
+  EXPECT_EQ(deter::computeDeterminantLU<double>(seen), deter::computeDeterminantLU(copy));
+}
+
+TEST(DeterTest, StructuredFastPaths) {
+  const deter::isa was = deter::kernelIsa();
+  deter::useIsa(deter::scalar);
+
+  // a random matrix with non-zeros only where keep says
+  std::srand(19);
+  auto make = [](const int n, auto keep) {
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n; i++) {
+      for (int j=0; j < n; j++) m(i, j) = keep(i, j) ? (1 + (std::rand() % 9)) * ((std::rand() % 2) ? 1 : -1) : 0;
+    }
+    return m;
+  };
+
+  for (int n=1; n <= 12; n++) {
+    std::vector<int> p(n);
+    for (int i=0; i < n; i++) p[i] = i;
+    for (int i=n-1; i > 0; i--) std::swap(p[i], p[std::rand() % (i + 1)]);
+    if (n > 1 && p[0] == 0) std::swap(p[0], p[1]); // not triangular
+
+    const struct { deter::structure kind; std::function<bool(int, int)> keep; } cases[] = {
+      { deter::diagonal, [](int i, int j) { return i == j; } },
+      { deter::upper_triangular, [](int i, int j) { return i <= j; } },
+      { deter::lower_triangular, [](int i, int j) { return i >= j; } },
+      { deter::permutation, [&p](int i, int j) { return p[i] == j; } },
+      { deter::banded, [](int i, int j) { return j - i <= 1 && i - j <= 1; } },
+      { deter::general, [](int i, int j) { return true; } },
+    };
+
+    for (const auto &c : cases) {
+      deter::Matrix<long> m = make(n, c.keep);
+      deter::structure expected = c.kind;
+      if (n == 1) expected = deter::diagonal;
+      else if (expected == deter::banded && n < 5) expected = deter::general; // too narrow to pay
+      ASSERT_EQ(deter::detectStructure(m).kind, expected) << "order " << n << " " << deter::structureName(c.kind);
+
+      // exact integers: every path gives the exact determinant
+      auto got = deter::computeDeterminantStructured(m, &deter::computeDeterminantLU<long>);
+      EXPECT_EQ(got.path, expected);
+      EXPECT_EQ(got.value, deter::computeDeterminantDP(m)) << "order " << n << " " << deter::structureName(c.kind);
+    }
+  }
+
+  // the band LU is the scalar LU to the bit, and keeps O(n * band) memory
+  const int n = 400;
+  deter::Matrix<double> band(n);
+  for (int i=0; i < n; i++) {
+    for (int j=std::max(0, i - 3); j <= std::min(n - 1, i + 2); j++) band(i, j) = ((std::rand() % 2001) - 1000) / 512.0;
+  }
+  deter::matrix_shape shape = deter::detectStructure(band);
+  EXPECT_EQ(shape.kind, deter::banded);
+  EXPECT_EQ(shape.lower, 3);
+  EXPECT_EQ(shape.upper, 2);
+  EXPECT_EQ(deter::bandedDeterminant(band, shape.lower, shape.upper), deter::computeDeterminantLU(band));
+
+  // the path is part of the report
+  deter::Matrix<double> d(2);
+  d(0, 0) = 2; d(1, 1) = 3;
+  std::ostringstream report;
+  deter::reportSummary(report, d, deter::computeDeterminantStructured(d, &deter::computeDeterminant<double>), std::chrono::milliseconds(0));
+  EXPECT_EQ(report.str(), "Given Matrix (M size: 2) = det(M) = 6 [diagonal](0ms)\n");
+
+  // an exact fallback keeps the banded matrices, whose band LU rounds at these sizes
+  int rounded = 0;
+  for (int k=0; k < 200; k++) {
+    deter::Matrix<double> tri(12);
+    for (int i=0; i < 12; i++) {
+      for (int j=std::max(0, i - 1); j <= std::min(11, i + 1); j++) tri(i, j) = (std::rand() % 1999) - 999;
+    }
+    ASSERT_EQ(deter::detectStructure(tri).kind, deter::banded);
+
+    const double exact = deter::computeDeterminantBareiss(tri);
+    auto got = deter::computeDeterminantStructured(tri, &deter::computeDeterminantBareiss<double>, true);
+    EXPECT_EQ(got.path, deter::general);
+    EXPECT_EQ(got.value, exact);
+    if (deter::bandedDeterminant(tri, 1, 1) != exact) rounded++;
+  }
+  EXPECT_GT(rounded, 0) << "the band LU no longer rounds, the check above proves nothing";
+
+  deter::useIsa(was);
+}
+
+TEST(DeterTest, SparseMatchesDense) {
+  std::srand(20);
+
+  // exact integers on small orders, any ordering and pivoting gives the same answer
+  for (int n=1; n <= 10; n++) {
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n * n; i++) m(i / n, i % n) = (std::rand() % 4 == 0) ? (std::rand() % 11) - 5 : 0;
+    EXPECT_EQ(deter::computeDeterminantSparse(m), deter::computeDeterminantDP(m)) << "order " << n;
+  }
+
+  // sparse with a zero free diagonal, and with a few rows that pivoting must move
+  const int n = 300;
+  deter::Matrix<double> m(n);
+  for (int i=0; i < n; i++) {
+    m(i, i) = (i % 17 == 0) ? 0 : 1 + (std::rand() % 100) / 25.0;
+    for (int k=0; k < 3; k++) m(i, std::rand() % n) = ((std::rand() % 2001) - 1000) / 256.0;
+  }
+  EXPECT_TRUE(deter::isSparse(m, 0.05));
+  EXPECT_FALSE(deter::isSparse(m, 0.01));
+
+  const double dense = deter::computeDeterminantLU(m);
+  const double sparse = deter::computeDeterminantSparse(m);
+  EXPECT_NEAR(sparse, dense, 1e-8 * std::abs(dense));
+
+  // dense enough that the rest is finished by the dense factorization, with a signed
+  // row permutation across both parts
+  deter::Matrix<double> fill(2 * deter::BLOCK_SIZE + 40);
+  for (int i=0; i < fill.order(); i++) {
+    for (int j=0; j < fill.order(); j++) {
+      if (i == j + 1 || std::rand() % 4 == 0) fill(i, j) = ((std::rand() % 2001) - 1000) / 256.0;
+    }
+  }
+  const double fill_dense = deter::computeDeterminantLU(fill);
+  EXPECT_NEAR(deter::computeDeterminantSparse(fill), fill_dense, 1e-8 * std::abs(fill_dense));
+
+  // the ordering is a permutation
+  const deter::compressed<double> rows = deter::compressRows<double>(m);
+  std::vector<int> order = deter::minimumDegreeOrder(rows, deter::transpose(rows));
+  std::sort(order.begin(), order.end());
+  for (int i=0; i < n; i++) ASSERT_EQ(order[i], i);
+
+  // an empty column is found without factoring the rest
+  for (int i=0; i < n; i++) m(i, 123) = 0;
+  EXPECT_EQ(deter::computeDeterminantSparse(m), 0);
+}
+
+TEST(DeterTest, BlockTriangularMatchesWhole) {
+  std::srand(21);
+  deter::ThreadPool pool(3);
+
+  for (int trial=0; trial < 20; trial++) {
+    // block upper triangular with blocks of order 1 to 4, then shuffled rows and columns
+    const int n = deter::BTF_MIN_ORDER + (trial % 7);
+    std::vector<int> first;
+    for (int i=0; i < n; i += 1 + (std::rand() % 4)) first.push_back(i);
+    first.push_back(n);
+
+    std::vector<long> a(n * n, 0);
+    for (size_t b=0; b + 1 < first.size(); b++) {
+      for (int i=first[b]; i < first[b + 1]; i++) {
+        for (int j=first[b]; j < n; j++) {
+          if (j < first[b + 1] || std::rand() % 3 == 0) a[(n * i) + j] = (std::rand() % 13) - 6;
+        }
+        a[(n * i) + i] = 1 + (std::rand() % 5); // a zero free diagonal
+      }
+    }
+
+    std::vector<int> pr(n), pc(n);
+    for (int i=0; i < n; i++) pr[i] = pc[i] = i;
+    for (int i=n-1; i > 0; i--) {
+      std::swap(pr[i], pr[std::rand() % (i + 1)]);
+      std::swap(pc[i], pc[std::rand() % (i + 1)]);
+    }
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n; i++) {
+      for (int j=0; j < n; j++) m(pr[i], pc[j]) = a[(n * i) + j];
+    }
+
+    const deter::block_form form = deter::blockTriangularForm(deter::compressRows<long>(m));
+    ASSERT_FALSE(form.singular);
+    EXPECT_GE(form.start.size() - 1, first.size() - 1) << "at least the blocks built in";
+
+    const long expected = deter::computeDeterminantBareiss(m);
+    EXPECT_EQ(deter::computeDeterminantBTF(m, &deter::computeDeterminantBareiss<long>, &pool), expected) << "trial " << trial;
+    EXPECT_EQ(deter::computeDeterminantBTF(m, &deter::computeDeterminantBareiss<long>, nullptr), expected) << "trial " << trial;
+  }
+
+  // two rows with non-zeros in only the same column: no zero free diagonal
+  deter::Matrix<double> s(12);
+  for (int i=0; i < 12; i++) s(i, i) = 1;
+  s(3, 3) = 0;
+  s(3, 5) = 2;
+  const deter::block_form form = deter::blockTriangularForm(deter::compressRows<double>(s));
+  EXPECT_TRUE(form.singular);
+  EXPECT_EQ(deter::computeDeterminantBTF(s, &deter::computeDeterminantLU<double>, &pool), 0);
+}
+
+TEST(DeterTest, CertifiedSign) {
+  std::srand(22);
+
+  // random integer matrices, the sign is that of the exact determinant
+  int filtered = 0;
+  for (int trial=0; trial < 60; trial++) {
+    const int n = 2 + (trial % 11);
+    deter::Matrix<long> m(n);
+    for (int i=0; i < n; i++) {
+      for (int j=0; j < n; j++) m(i, j) = (std::rand() % 21) - 10;
+    }
+    if (trial % 5 == 0) {
+      for (int j=0; j < n; j++) m(n - 1, j) = m(0, j) - (2 * m(1, j)); // singular
+    }
+
+    const long det = deter::computeDeterminantBareiss(m);
+    const deter::certified_sign s = deter::certifySign(m, nullptr);
+    EXPECT_EQ(s.sign, (det > 0) - (det < 0)) << "trial " << trial;
+    if (det == 0) {
+      EXPECT_TRUE(s.exact) << "a zero is never left to the filter";
+    }
+    filtered += !s.exact;
+  }
+  EXPECT_GE(filtered, 40) << "most signs come from the filter";
+
+  // 2^-52 apart from singular, below what the filter can see
+  deter::Matrix<double> close(2);
+  close(0, 0) = 1 + std::ldexp(1.0, -52); close(0, 1) = 1;
+  close(1, 0) = 1;                        close(1, 1) = 1;
+  EXPECT_EQ(deter::certifySign(close, nullptr).sign, 1);
+  EXPECT_TRUE(deter::certifySign(close, nullptr).exact);
+
+  // a spread of powers of two no 62 bit integer holds, exactly singular and then not
+  deter::Matrix<double> wide(2);
+  wide(0, 0) = std::ldexp(1.0, 100); wide(0, 1) = std::ldexp(1.0, -100);
+  wide(1, 0) = 1;                     wide(1, 1) = std::ldexp(1.0, -200);
+  EXPECT_EQ(deter::exactSign(wide, nullptr), 0);
+  wide(1, 1) = std::ldexp(1 + std::ldexp(1.0, -52), -200);
+  EXPECT_EQ(deter::exactSign(wide, nullptr), 1);
+  wide(1, 1) = -wide(1, 1);
+  deter::ThreadPool pool(2);
+  EXPECT_EQ(deter::exactSign(wide, &pool), -1);
+
+  // through read_matrices
+  std::stringstream in("3\n1 2 3\n4 5 6\n7 8 10\n2\n1 2\n2 4\n");
+  std::stringstream out;
+  EXPECT_EQ((deter::read_matrices<double, deter::certified_sign>(in, out, deter::computeSignCertified<double>, deter::reportSummary<double, deter::certified_sign>)), 0);
+  EXPECT_NE(out.str().find("= det(M) = -1 [filter]("), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("= det(M) = 0 [exact]("), std::string::npos) << out.str();
+}
+
+TEST(DeterTest, FactorizationReuse) {
+  std::srand(23);
+  const int n = 150;
+  deter::Matrix<double> a(n);
+  for (int i=0; i < n; i++) {
+    for (int j=0; j < n; j++) a(i, j) = (std::rand() % 2001 - 1000) / 100.0;
+  }
+
+  deter::Factorization<double> lu(a);
+  EXPECT_EQ(lu.det(), deter::computeDeterminantBlocked(a));
+  const deter::log_determinant<double> ld = lu.logdet();
+  EXPECT_EQ(ld.sign, (lu.det() > 0) ? 1 : -1);
+  EXPECT_NEAR(ld.log, std::log(std::abs(lu.det())), 1e-9);
+
+  // A X = B for three right hand sides, and A A^-1 = I
+  deter::Matrix<double> b(n, 3, 0), x(n, 3, 0);
+  for (int i=0; i < n; i++) {
+    for (int c=0; c < 3; c++) b(i, c) = x(i, c) = std::rand() % 7 - 3;
+  }
+  lu.solve(x);
+  const deter::Matrix<double> inv = lu.inverse();
+  for (int i=0; i < n; i++) {
+    for (int c=0; c < 3; c++) {
+      double sum = 0;
+      for (int k=0; k < n; k++) sum += a(i, k) * x(k, c);
+      EXPECT_NEAR(sum, b(i, c), 1e-8);
+    }
+    for (int j=0; j < n; j++) {
+      double sum = 0;
+      for (int k=0; k < n; k++) sum += a(i, k) * inv(k, j);
+      EXPECT_NEAR(sum, (i == j) ? 1 : 0, 1e-10);
+    }
+  }
+
+  // the log holds where the determinant overflows
+  deter::Matrix<double> big(400);
+  for (int i=0; i < 400; i++) big(i, i) = (i % 2) ? -10 : 10;
+  lu.factor(big);
+  EXPECT_TRUE(std::isinf(lu.det()));
+  EXPECT_EQ(lu.logdet().sign, 1);
+  EXPECT_NEAR(lu.logdet().log, 400 * std::log(10.0), 1e-9);
+
+  // through the parser, the right hand sides following their matrix
+  std::stringstream in("3\n2 1 1\n1 3 2\n1 0 0\nrhs 2\n4 1\n5 0\n6 2\n2\n1 2\n2 4\nrhs 1\n1\n2\n");
+  std::stringstream out;
+  EXPECT_EQ((deter::read_factored<double>(in, out, true, deter::reportSummary<double, deter::factored<double>>)), 0);
+  EXPECT_NE(out.str().find("= det(M) = -1 log|det(M)| = 0("), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Solution (size: 3 x 2):\n|   6   2 |\n|  15   4 |\n| -23  -7 |\n\n"), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Inverse:\n|  0  0  1 |\n| -2  1  3 |\n|  3 -1 -5 |\n\n"), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Solution (size: 2 x 1): none, the matrix is singular"), std::string::npos) << out.str();
+
+  // a directive with nothing to solve, and one the plain reader does not take
+  std::stringstream early("rhs 1\n1\n"), none("1\n2\nrhs 0\n"), plain("1\n2\nrhs 1\n3\n");
+  std::stringstream o1, o2, o3;
+  EXPECT_EQ((deter::read_factored<double>(early, o1, false, deter::reportSummary<double, deter::factored<double>>)), 1);
+  EXPECT_EQ((deter::read_factored<double>(none, o2, false, deter::reportSummary<double, deter::factored<double>>)), 1);
+  EXPECT_NE(o2.str().find("Expected at least one right hand side"), std::string::npos) << o2.str();
+  EXPECT_EQ((deter::read_matrices<double>(plain, o3, deter::computeDeterminantLU<double>, deter::reportSummary<double>)), 1);
+  EXPECT_NE(o3.str().find("Invalid data and end of row: "), std::string::npos) << o3.str();
+}
+
+TEST(DeterTest, IncrementalUpdates) {
+  std::srand(24);
+  const int n = 60;
+  deter::Matrix<double> a(n);
+  for (int i=0; i < n; i++) {
+    for (int j=0; j < n; j++) a(i, j) = (std::rand() % 2001 - 1000) / 100.0;
+  }
+
+  deter::IncrementalFactorization<double> lu;
+  lu.factor(a);
+  std::vector<double> values(n);
+  for (int step=0; step < 40; step++) {
+    const int k = std::rand() % n;
+    for (int j=0; j < n; j++) values[j] = (std::rand() % 2001 - 1000) / 100.0;
+    if (step % 3 == 0) {
+      lu.replaceColumn(k, values.data());
+      for (int i=0; i < n; i++) a(i, k) = values[i];
+    } else {
+      lu.replaceRow(k, values.data());
+      for (int j=0; j < n; j++) a(k, j) = values[j];
+    }
+
+    const double expected = deter::computeDeterminantBlocked(a);
+    EXPECT_NEAR(lu.det(), expected, 1e-9 * std::abs(expected)) << "step " << step;
+    EXPECT_NEAR(lu.logdet().log, std::log(std::abs(expected)), 1e-9) << "step " << step;
+  }
+  EXPECT_LE(lu.factorizations(), 1 + (40 / deter::UPDATE_REFRESH) + 1) << "updates are not factorizations";
+
+  // a determinant that underflows is not a singular matrix, the updates still apply
+  {
+    deter::Matrix<double> tiny(100);
+    for (int i=0; i < 100; i++) {
+      for (int j=0; j < 100; j++) tiny(i, j) = 1e-4 * ((std::rand() % 2001) - 1000) / 1000.0;
+    }
+    deter::IncrementalFactorization<double> small;
+    small.factor(tiny);
+    ASSERT_EQ(small.det(), 0);
+    ASSERT_NE(small.logdet().sign, 0);
+
+    std::vector<double> values(100);
+    for (int step=0; step < 10; step++) {
+      for (double &x : values) x = 1e-4 * ((std::rand() % 2001) - 1000) / 1000.0;
+      small.replaceRow(std::rand() % 100, values.data());
+    }
+    EXPECT_EQ(small.factorizations(), 1);
+
+    deter::Factorization<double> whole;
+    whole.factor(small.matrix());
+    EXPECT_EQ(small.logdet().sign, whole.logdet().sign);
+    EXPECT_NEAR(small.logdet().log, whole.logdet().log, 1e-8 * std::abs(whole.logdet().log));
+  }
+
+  // a singular matrix is factored again until it is not
+  deter::Matrix<double> s(3);
+  s(0, 0) = 1; s(1, 1) = 1;
+  lu.factor(s);
+  EXPECT_EQ(lu.det(), 0);
+  const double row[] = { 0, 1, 4 };
+  lu.replaceRow(2, row);
+  EXPECT_EQ(lu.det(), 4);
+
+  // through the parser
+  std::stringstream in("3\n2 1 1\n1 3 2\n1 0 0\nupdate row 2\n1 1 0\nupdate column 0\n0 0 0\nupdate column 0\n5 1 2\nrhs 1\n1\n2\n3\n");
+  std::stringstream out;
+  EXPECT_EQ((deter::read_factored<double>(in, out, false, deter::reportSummary<double, deter::factored<double>>)), 0);
+  EXPECT_NE(out.str().find("Update (row 2) = det(M) = -4 log|det(M)| ="), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Update (column 0) = det(M) = 0 log|det(M)| = -inf("), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Update (column 0) = det(M) = -11 log|det(M)| ="), std::string::npos) << out.str();
+  EXPECT_NE(out.str().find("Solution (size: 3 x 1):\n|  0.272727 |\n|   2.45455 |\n|  -2.81818 |"), std::string::npos) << out.str();
+
+  std::stringstream bad("2\n1 0\n0 1\nupdate row 2\n1 1\n"), o2;
+  EXPECT_EQ((deter::read_factored<double>(bad, o2, false, deter::reportSummary<double, deter::factored<double>>)), 1);
+  EXPECT_NE(o2.str().find("Expected an index below the order of the matrix"), std::string::npos) << o2.str();
+
+  std::stringstream wide("1\n2\nrhs 99999999\n1\n"), o3;
+  EXPECT_EQ((deter::read_factored<double>(wide, o3, false, deter::reportSummary<double, deter::factored<double>>)), 1);
+  EXPECT_NE(o3.str().find("Expected at most 1048576 right hand sides"), std::string::npos) << o3.str();
+}
+
+TEST(DeterTest, ResultCache) {
+  // the published MurmurHash3 x64 128 values, fed whole and in pieces
+  const std::string fox = "The quick brown fox jumps over the lazy dog";
+  deter::Murmur3 whole;
+  whole.add(fox.data(), fox.size());
+  const deter::hash128 h = whole.finish();
+  EXPECT_EQ(h.lo, 0xe34bbc7bbc071b6cULL);
+  EXPECT_EQ(h.hi, 0x7a433ca9c49a9347ULL);
+
+  deter::Murmur3 pieces;
+  for (size_t at=0; at < fox.size(); at += 5) pieces.add(fox.data() + at, std::min((size_t) 5, fox.size() - at));
+  const deter::hash128 p = pieces.finish();
+  EXPECT_EQ(p.lo, h.lo);
+  EXPECT_EQ(p.hi, h.hi);
+
+  // the padding of the rows is not part of the hash
+  deter::Matrix<double> a(3, 3, 8), b(3);
+  for (int i=0; i < 3; i++) for (int j=0; j < 3; j++) a(i, j) = b(i, j) = (i * 3) + j + (i == j);
+  EXPECT_EQ(deter::hashMatrix(a, 7).lo, deter::hashMatrix(b, 7).lo);
+
+  int calls = 0;
+  auto compute = [&calls](const deter::Matrix<double> &m) { calls++; return deter::computeDeterminantLU(m); };
+
+  deter::ResultCache<double> memory("lu", nullptr);
+  const double expected = deter::computeDeterminantLU(b);
+  EXPECT_EQ(memory.get(a, compute), expected);
+  EXPECT_EQ(memory.get(b, compute), expected);
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(memory.hits(), 1);
+  EXPECT_EQ(memory.misses(), 1);
+
+  // the same bytes as another type are another matrix
+  deter::Matrix<double> zeros(3);
+  deter::Matrix<int64_t> ints(3);
+  EXPECT_EQ(deter::hashMatrix(zeros, 0).lo, deter::hashMatrix(ints, 0).lo);
+  EXPECT_EQ(memory.get(zeros, compute), 0);
+  EXPECT_EQ(memory.get(ints, [](const deter::Matrix<int64_t>&) { return 1.0; }), 1);
+  EXPECT_EQ(memory.misses(), 3);
+
+  // the store outlives the process, and grows
+  const std::string path = ::testing::TempDir() + "deter_cache_test.bin";
+  std::remove(path.c_str());
+  {
+    deter::ResultCache<double> disk("lu", path.c_str());
+    deter::Matrix<double> m(2);
+    for (int k=0; k < 1500; k++) {
+      m(0, 0) = k; m(1, 1) = 2;
+      EXPECT_EQ(disk.get(m, compute), 2.0 * k);
+    }
+    EXPECT_EQ(disk.misses(), 1500);
+  }
+  {
+    deter::CacheStore store(path.c_str());
+    EXPECT_EQ(store.size(), 1500u);
+  }
+  {
+    calls = 0;
+    deter::ResultCache<double> disk("lu", path.c_str());
+    deter::Matrix<double> m(2);
+    for (int k=0; k < 1500; k++) {
+      m(0, 0) = k; m(1, 1) = 2;
+      EXPECT_EQ(disk.get(m, compute), 2.0 * k);
+    }
+    EXPECT_EQ(disk.hits(), 1500);
+    EXPECT_EQ(calls, 0);
+
+    // while it is open no one else has the file
+    EXPECT_THROW(deter::CacheStore store(path.c_str()), std::runtime_error);
+  }
+  {
+    // another engine does not see them
+    deter::ResultCache<double> other("blocked", path.c_str());
+    deter::Matrix<double> m(2);
+    other.get(m, compute);
+    EXPECT_EQ(other.misses(), 1);
+  }
+
+  // a file that is not a store is refused
+  std::ofstream(path, std::ios::trunc) << "not a cache at all, but long enough to hold a header of 64 bytes";
+  EXPECT_THROW(deter::CacheStore store(path.c_str()), std::runtime_error);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,313 @@
+#include <mutex>
+
+#include "exact.h"
+
+/**
+ * Implementation for the wide arithmetic used by the exact engines.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+  typedef unsigned __int128 u128;
+
+  /**
+   * A 256 bit magnitude with a sign, just enough to hold a product of two __int128.
+   */
+  struct wide {
+    u128 hi, lo;
+    bool negative;
+  };
+
+  u128 magnitude(__int128 v) {
+    return (v < 0) ? (u128) 0 - (u128) v : (u128) v;
+  }
+
+  wide multiply(__int128 a, __int128 b) {
+    const u128 x = magnitude(a), y = magnitude(b);
+    const u128 mask = ~(uint64_t) 0;
+    const u128 x0 = x & mask, x1 = x >> 64, y0 = y & mask, y1 = y >> 64;
+
+    u128 p00 = x0 * y0, p01 = x0 * y1, p10 = x1 * y0, p11 = x1 * y1;
+    u128 mid = (p00 >> 64) + (p01 & mask) + (p10 & mask);
+
+    wide w;
+    w.lo = (p00 & mask) | (mid << 64);
+    w.hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    w.negative = (w.hi | w.lo) != 0 && ((a < 0) != (b < 0));
+    return w;
+  }
+
+  bool less(const wide &x, const wide &y) {
+    return (x.hi < y.hi) || (x.hi == y.hi && x.lo < y.lo);
+  }
+
+  // |x| - |y| for |x| >= |y|
+  wide sub_magnitude(const wide &x, const wide &y) {
+    wide w;
+    w.lo = x.lo - y.lo;
+    w.hi = x.hi - y.hi - (x.lo < y.lo);
+    w.negative = x.negative;
+    return w;
+  }
+
+  wide subtract(wide x, wide y) {
+    y.negative = !y.negative && (y.hi | y.lo) != 0;
+
+    if (x.negative == y.negative) {
+      wide w;
+      w.lo = x.lo + y.lo;
+      w.hi = x.hi + y.hi + (w.lo < x.lo); // a carry out of hi is impossible for products of __int128
+      w.negative = x.negative;
+      return w;
+    }
+
+    return less(x, y) ? sub_magnitude(y, x) : sub_magnitude(x, y);
+  }
+}
+
+bool deter::mulSubDiv(int64_t a, int64_t b, int64_t c, int64_t d, int64_t p, int64_t &out) {
+  __int128 q = ((__int128) a * b - (__int128) c * d) / p;
+  if (q > INT64_MAX || q < INT64_MIN) return false;
+
+  out = (int64_t) q;
+  return true;
+}
+
+bool deter::mulSubDiv(__int128 a, __int128 b, __int128 c, __int128 d, __int128 p, __int128 &out) {
+  // the common case, nothing overflows
+  __int128 x, y;
+  if (!__builtin_mul_overflow(a, b, &x) && !__builtin_mul_overflow(c, d, &y) && !__builtin_sub_overflow(x, y, &x)) {
+    out = x / p;
+    return true;
+  }
+
+  wide num = subtract(multiply(a, b), multiply(c, d));
+  const u128 den = magnitude(p);
+
+  // the quotient has to fit in 128 bits
+  if (num.hi >= den) return false;
+
+  // shift and subtract long division of the 256 bit magnitude
+  u128 rem = num.hi, q = 0;
+  for (int i=127; i >= 0; i--) {
+    bool carry = (rem >> 127) != 0;
+    rem = (rem << 1) | ((num.lo >> i) & 1);
+    q <<= 1;
+    if (carry || rem >= den) {
+      rem -= den;
+      q |= 1;
+    }
+  }
+
+  const bool negative = num.negative != (p < 0);
+  const u128 limit = ((u128) 1 << 127) - (negative ? 0 : 1);
+  if (q > limit) return false;
+
+  out = negative ? (__int128) ((u128) 0 - q) : (__int128) q;
+  return true;
+}
+
+namespace {
+
+  uint64_t mulmod(uint64_t a, uint64_t b, uint64_t p) {
+    return (uint64_t) (((u128) a * b) % p);
+  }
+
+  uint64_t powmod(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t r = 1 % p;
+    for (; e; e >>= 1) {
+      if (e & 1) r = mulmod(r, a, p);
+      a = mulmod(a, a, p);
+    }
+    return r;
+  }
+
+  /**
+   * Miller-Rabin with a base set that is deterministic for every 64 bit n.
+   */
+  bool isPrime(uint64_t n) {
+    if (n < 2) return false;
+    for (uint64_t q : { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 }) {
+      if (n % q == 0) return n == q;
+    }
+
+    uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; s++; }
+
+    for (uint64_t a : { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 }) {
+      uint64_t x = powmod(a % n, d, n);
+      if (x == 0 || x == 1 || x == n - 1) continue;
+
+      bool composite = true;
+      for (int i=1; i < s && composite; i++) {
+        x = mulmod(x, x, n);
+        if (x == n - 1) composite = false;
+      }
+      if (composite) return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Montgomery arithmetic modulo an odd p < 2^62 with R = 2^64. Values are kept in
+   * Montgomery form (a * R mod p) so a product costs two multiplies and no division.
+   */
+  struct montgomery {
+    uint64_t p, ninv, r2;
+
+    explicit montgomery(uint64_t p) : p(p) {
+      // Newton's iteration for p^-1 mod 2^64, every step doubles the correct bits
+      uint64_t inv = p;
+      for (int i=0; i < 5; i++) inv *= 2 - (p * inv);
+      ninv = 0 - inv;
+
+      uint64_t r = (uint64_t) (((u128) 1 << 64) % p);
+      r2 = mulmod(r, r, p);
+    }
+
+    uint64_t reduce(u128 t) const {
+      uint64_t m = (uint64_t) t * ninv;
+      uint64_t r = (uint64_t) ((t + (u128) m * p) >> 64);
+      return (r >= p) ? r - p : r;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce((u128) a * b); }
+    uint64_t to(uint64_t a) const { return mul(a, r2); }
+    uint64_t from(uint64_t a) const { return reduce(a); }
+    uint64_t sub(uint64_t a, uint64_t b) const { return (a >= b) ? a - b : a + p - b; }
+
+    uint64_t pow(uint64_t a, uint64_t e) const {
+      uint64_t r = to(1);
+      for (; e; e >>= 1) {
+        if (e & 1) r = mul(r, a);
+        a = mul(a, a);
+      }
+      return r;
+    }
+  };
+
+}
+
+std::vector<uint64_t> deter::modularPrimes(size_t count) {
+  static std::mutex lock;
+  static std::vector<uint64_t> primes;
+
+  std::lock_guard<std::mutex> guard(lock);
+  uint64_t candidate = primes.empty() ? ((uint64_t) 1 << 62) - 1 : primes.back() - 2;
+  for (; primes.size() < count; candidate -= 2) {
+    if (isPrime(candidate)) primes.push_back(candidate);
+  }
+
+  return std::vector<uint64_t>(primes.begin(), primes.begin() + count);
+}
+
+uint64_t deter::determinantModP(const int n, const int64_t *a, uint64_t p) {
+  const montgomery mont(p);
+
+  std::vector<uint64_t> m((size_t) n * n);
+  for (size_t i=0; i < m.size(); i++) {
+    int64_t r = a[i] % (int64_t) p;
+    m[i] = mont.to((uint64_t) ((r < 0) ? r + (int64_t) p : r));
+  }
+
+  uint64_t det = mont.to(1);
+  bool negate = false;
+
+  for (int k=0; k < n; k++) {
+    int piv = k;
+    while (piv < n && m[((size_t) n * piv) + k] == 0) piv++;
+    if (piv == n) return 0;
+
+    if (piv != k) {
+      std::swap_ranges(m.begin() + ((size_t) n * k), m.begin() + ((size_t) n * k) + n, m.begin() + ((size_t) n * piv));
+      negate = !negate;
+    }
+
+    uint64_t *rk = m.data() + ((size_t) n * k);
+    det = mont.mul(det, rk[k]);
+
+    // scale the pivot row so the multipliers are the entries below the pivot
+    const uint64_t inv = mont.pow(rk[k], p - 2);
+    for (int j=k+1; j < n; j++) rk[j] = mont.mul(rk[j], inv);
+
+    for (int i=k+1; i < n; i++) {
+      uint64_t *ri = m.data() + ((size_t) n * i);
+      const uint64_t f = ri[k];
+      if (f == 0) continue;
+      for (int j=k+1; j < n; j++) ri[j] = mont.sub(ri[j], mont.mul(f, rk[j]));
+    }
+  }
+
+  det = mont.from(det);
+  return (negate && det != 0) ? p - det : det;
+}
+
+double deter::hadamardBits(const int n, const int64_t *a) {
+  long double bits = 0;
+  for (int i=0; i < n; i++) {
+    long double norm = 0;
+    for (int j=0; j < n; j++) norm += (long double) a[((size_t) n * i) + j] * a[((size_t) n * i) + j];
+    if (norm == 0) return -1;
+    bits += std::log2(norm) / 2;
+  }
+
+  return (double) bits;
+}
+
+deter::BigInt deter::reconstructCRT(const std::vector<uint64_t> &residues, const std::vector<uint64_t> &primes) {
+  if (residues.empty()) return BigInt();
+
+  // Garner's mixed radix form, x stays in [0, M) for the product M of the primes so far
+  BigInt x = (__int128) residues[0];
+  BigInt modulus = (__int128) primes[0];
+  for (size_t i=1; i < residues.size(); i++) {
+    const uint64_t p = primes[i];
+    uint64_t diff = (residues[i] + p - x.mod(p)) % p;
+    uint64_t t = mulmod(diff, powmod(modulus.mod(p), p - 2, p), p);
+
+    x = x + (modulus * t);
+    modulus = modulus * p;
+  }
+
+  // symmetric residue: the upper half of [0, M) stands for the negative values
+  if (x * (uint64_t) 2 > modulus) x = x - modulus;
+  return x;
+}
+
+deter::BigInt deter::modularDeterminant(const int n, const int64_t *a, ThreadPool *pool) {
+  if (n < 1) return BigInt();
+
+  const double bound = hadamardBits(n, a);
+  if (bound < 0) return BigInt();
+
+  // the primes are all above 2^61.99, one spare bit covers the sign and rounding
+  const size_t count = (size_t) std::ceil((bound + 2) / 61.99);
+  const std::vector<uint64_t> primes = modularPrimes(count);
+
+  std::vector<uint64_t> residues(count);
+  auto solve = [&](long i) { residues[i] = determinantModP(n, a, primes[i]); };
+  if (pool != nullptr && count > 1) {
+    pool->parallel_for(0, (long) count, solve);
+  } else {
+    for (size_t i=0; i < count; i++) solve((long) i);
+  }
+
+  return reconstructCRT(residues, primes);
+}
+
+deter::BigInt deter::exactDeterminant(const int n, const int64_t *a, ThreadPool *pool) {
+  if (n < 1) return BigInt();
+
+  std::vector<int64_t> narrow(a, a + ((size_t) n * n));
+  int64_t det;
+  if (bareiss(n, narrow.data(), det)) return BigInt((__int128) det);
+
+  std::vector<__int128> wide(a, a + ((size_t) n * n));
+  __int128 wdet;
+  if (bareiss(n, wide.data(), wdet)) return BigInt(wdet);
+
+  return modularDeterminant(n, a, pool);
+}
@@ -0,0 +1,323 @@
+/**
+ * Exact determinant engines. Unlike the elimination engines in deter.h these never
+ * divide in floating point, for integer input they reproduce computeDeterminant's
+ * result exactly, only much faster.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef EXACT_H
+#define EXACT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bigint.h"
+#include "matrix.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * The largest order computeDeterminantDP accepts, its table holds 2^n values.
+   */
+  const int DP_MAX_ORDER = 25;
+
+  /**
+   * Computes the determinant by dynamic programming over subsets of columns, O(n * 2^n).
+   *
+   * Laplace expansion down the rows visits the same minors over and over: the minor left
+   * after expanding the first d rows only depends on which d columns those rows used, not
+   * on the order they were used in. So with f(mask) the determinant of the rows
+   * popcount(mask) and below over the columns not in mask,
+   *
+   *   f(full) = 1
+   *   f(mask) = sum over c not in mask of (-1)^(free columns before c) * m[popcount(mask)][c] * f(mask | c)
+   *
+   * and det(M) = f(0). This is exactly the first row expansion of computeDeterminant
+   * (same products, same signs) with every repeated minor computed once, so integer
+   * results are identical. Every mask of one popcount only depends on masks of the next
+   * popcount, so each layer is computed in parallel when a pool is given.
+   *
+   * @param matrix - The matrix data.
+   * @param pool - threads to spread each layer over, or nullptr to run on the calling thread.
+   * @return the determinant for the given matrix.
+   * @throw std::length_error if the order is above DP_MAX_ORDER.
+   */
+  template<typename T>
+    T determinantBySubsets(const Matrix<T> &matrix, ThreadPool *pool) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      const int size = matrix.order();
+      if (size < 1) return 0;
+      if (size > DP_MAX_ORDER) {
+        throw std::length_error("The dp engine supports orders up to " + std::to_string(DP_MAX_ORDER));
+      }
+
+      const int n = size;
+      const uint32_t full = (1u << n) - 1;
+      std::vector<T> f((size_t) full + 1);
+      f[full] = 1;
+
+      auto solve = [&](uint32_t mask) {
+        const T *row = matrix.row(__builtin_popcount(mask));
+        T sum = 0;
+        int pos = 0;
+        for (uint32_t free = full & ~mask; free; free &= free - 1, pos++) {
+          const int c = __builtin_ctz(free);
+          if (row[c] == 0) continue;
+          T term = row[c] * f[mask | (1u << c)];
+          sum += (pos % 2 == 0) ? term : -term;
+        }
+        f[mask] = sum;
+      };
+
+      // the masks of one layer are enumerated in chunks sharing their top bits, the low
+      // bits of each chunk walk the combinations of the right popcount (Gosper's hack)
+      const int high = std::min(n, 6);
+      const int low = n - high;
+      auto chunk = [&](const int layer, const uint32_t top) {
+        const int need = layer - __builtin_popcount(top);
+        if (need < 0 || need > low) return;
+
+        const uint32_t base = top << low;
+        if (need == 0) { solve(base); return; }
+
+        uint32_t x = (1u << need) - 1;
+        while (x < (1u << low)) {
+          solve(base | x);
+          uint32_t c = x & (0u - x);
+          uint32_t r = x + c;
+          x = (((r ^ x) >> 2) / c) | r;
+        }
+      };
+
+      for (int layer=n-1; layer >= 0; layer--) {
+        if (pool != nullptr && n > 12) {
+          pool->parallel_for(0, 1l << high, [&](long top) { chunk(layer, (uint32_t) top); });
+        } else {
+          for (uint32_t top=0; top < (1u << high); top++) chunk(layer, top);
+        }
+      }
+
+      return f[0];
+    }
+
+  /**
+   * determinantBySubsets on the calling thread, with the compute callback signature.
+   */
+  template<typename T>
+    T computeDeterminantDP(const Matrix<T> &matrix) {
+      return determinantBySubsets(matrix, nullptr);
+    }
+
+  /**
+   * Copies a matrix into an integer type for the integer only engines.
+   *
+   * @param m - the matrix.
+   * @param out - receives the converted values, row-major without padding.
+   * @throw std::invalid_argument if a value is not an integer or does not fit int64_t.
+   */
+  template<typename W, typename T>
+    void toInteger(const Matrix<T> &m, std::vector<W> &out) {
+      const int n = m.order();
+      out.resize((size_t) n * n);
+      for (int i=0; i < n; i++) {
+        const T *row = m.row(i);
+        for (int j=0; j < n; j++) {
+          if (std::is_floating_point<T>::value) {
+            // 2^63 is exact in floating point, anything at or above it does not fit
+            if (row[j] != std::trunc(row[j]) || std::abs(row[j]) >= 9223372036854775808.0) {
+              throw std::invalid_argument("The matrix holds a value that is not an integer: " + std::to_string(row[j]));
+            }
+          }
+          out[((size_t) n * i) + j] = (W) (int64_t) row[j];
+        }
+      }
+    }
+
+  /**
+   * out = (a * b - c * d) / p for a division known to be exact, with the products formed
+   * in twice the width of the arguments so they cannot overflow.
+   *
+   * @return false if the result does not fit the type of out.
+   */
+  bool mulSubDiv(int64_t a, int64_t b, int64_t c, int64_t d, int64_t p, int64_t &out);
+  bool mulSubDiv(__int128 a, __int128 b, __int128 c, __int128 d, __int128 p, __int128 &out);
+
+  /**
+   * Bareiss' fraction free elimination in the integer type W. Each step replaces
+   *
+   *   a[i][j] = (a[i][j] * a[k][k] - a[i][k] * a[k][j]) / a[k-1][k-1]
+   *
+   * where the division is always exact, every entry stays an integer minor of the input
+   * and the last pivot is the determinant. O(n^3) with no rounding at all. The products
+   * are formed in twice the width of W (see mulSubDiv), the elimination only stops when
+   * an entry itself leaves the range of W.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data (n * n), destroyed.
+   * @param det - receives the determinant.
+   * @return false if W overflowed (det is then meaningless), true otherwise.
+   */
+  template<typename W>
+    bool bareiss(const int n, W *a, W &det) {
+      W prev = 1;
+      bool negate = false;
+
+      for (int k=0; k < n; k++) {
+        if (a[(n * k) + k] == 0) {
+          int p = k + 1;
+          while (p < n && a[(n * p) + k] == 0) p++;
+          if (p == n) { det = 0; return true; }
+
+          std::swap_ranges(a + (n * k), a + (n * k) + n, a + (n * p));
+          negate = !negate;
+        }
+
+        const W *rk = a + (n * k);
+        for (int i=k+1; i < n; i++) {
+          W *ri = a + (n * i);
+          for (int j=k+1; j < n; j++) {
+            if (!mulSubDiv(ri[j], rk[k], ri[k], rk[j], prev, ri[j])) return false;
+          }
+        }
+
+        prev = rk[k];
+      }
+
+      det = (n == 0) ? 0 : (negate ? -prev : prev);
+      return true;
+    }
+
+  /**
+   * Computes the exact determinant of an integer valued matrix with bareiss. The
+   * elimination runs in int64_t and is repeated in __int128 if that overflows.
+   *
+   * @param matrix - The matrix data, the values must be integers.
+   * @return the determinant for the given matrix.
+   * @throw std::invalid_argument if the matrix holds a value that is not an integer.
+   * @throw std::overflow_error if the determinant needs more than 128 bits, or more than T holds.
+   */
+  template<typename T>
+    T computeDeterminantBareiss(const Matrix<T> &matrix) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      const int size = matrix.order();
+      if (size < 1) return 0;
+
+      std::vector<int64_t> a;
+      toInteger(matrix, a);
+
+      int64_t det;
+      if (bareiss(size, a.data(), det)) {
+        if (std::is_integral<T>::value && (T) det != det) throw std::overflow_error("The determinant does not fit the result type");
+        return (T) det;
+      }
+
+      std::vector<__int128> wide;
+      toInteger(matrix, wide);
+
+      __int128 wdet;
+      if (bareiss(size, wide.data(), wdet)) {
+        if (std::is_integral<T>::value && (T) wdet != wdet) throw std::overflow_error("The determinant does not fit the result type");
+        return (T) wdet;
+      }
+
+      throw std::overflow_error("The determinant needs more than 128 bits");
+    }
+
+  /**
+   * @param count - how many primes are wanted.
+   * @return the count largest primes below 2^62, largest first, always the same ones.
+   */
+  std::vector<uint64_t> modularPrimes(size_t count);
+
+  /**
+   * Gaussian elimination over the integers modulo p, in Montgomery form.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data (n * n).
+   * @param p - an odd prime below 2^62.
+   * @return det(a) mod p, in [0, p).
+   */
+  uint64_t determinantModP(const int n, const int64_t *a, uint64_t p);
+
+  /**
+   * @param n - the order of the matrix.
+   * @param a - the matrix data (n * n).
+   * @return log2 of Hadamard's bound on |det(a)|, the product of the row norms, or -1 if
+   * a row is zero (and so is the determinant).
+   */
+  double hadamardBits(const int n, const int64_t *a);
+
+  /**
+   * Chinese remaindering of the residues of one value modulo distinct primes.
+   *
+   * @return the value x with |x| < M/2 for the product M of the primes.
+   */
+  BigInt reconstructCRT(const std::vector<uint64_t> &residues, const std::vector<uint64_t> &primes);
+
+  /**
+   * The work of determinantByPrimes on a matrix already in integers.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data (n * n).
+   * @param pool - threads to spread the primes over, or nullptr to run on the calling thread.
+   * @return the determinant of a.
+   */
+  BigInt modularDeterminant(const int n, const int64_t *a, ThreadPool *pool);
+
+  /**
+   * The exact determinant of an integer matrix by the cheapest engine that holds it:
+   * bareiss in int64_t, then in __int128, then modularDeterminant.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data (n * n).
+   * @param pool - threads for modularDeterminant, or nullptr to run on the calling thread.
+   * @return the determinant of a.
+   */
+  BigInt exactDeterminant(const int n, const int64_t *a, ThreadPool *pool);
+
+  /**
+   * Computes the exact determinant of an integer valued matrix by multi-modular
+   * arithmetic. The determinant is computed modulo as many 62 bit primes as it takes for
+   * their product to pass twice Hadamard's bound, and then put back together with the
+   * chinese remainder theorem. Every prime is an independent O(n^3) elimination in 64 bit
+   * words, no intermediate value ever grows, and the primes run in parallel when a pool
+   * is given. There is no limit on the size of the result.
+   *
+   * @param matrix - The matrix data, the values must be integers.
+   * @param pool - threads to spread the primes over, or nullptr to run on the calling thread.
+   * @return the determinant for the given matrix.
+   * @throw std::invalid_argument if the matrix holds a value that is not an integer.
+   */
+  template<typename T>
+    BigInt determinantByPrimes(const Matrix<T> &matrix, ThreadPool *pool) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      if (matrix.order() < 1) return BigInt();
+
+      std::vector<int64_t> a;
+      toInteger(matrix, a);
+
+      return modularDeterminant(matrix.order(), a.data(), pool);
+    }
+
+  /**
+   * determinantByPrimes on the calling thread, with the compute callback signature.
+   */
+  template<typename T>
+    BigInt computeDeterminantModular(const Matrix<T> &matrix) {
+      return determinantByPrimes(matrix, nullptr);
+    }
+
+}
+
+#endif
@@ -0,0 +1,503 @@
+/**
+ * One LU factorization of a matrix, and everything that follows from it. The determinant
+ * engines factor a matrix and keep only the product of the diagonal, but the factors
+ * also give log|det(M)|, which does not overflow where det(M) does, the solution of any
+ * number of right hand sides at O(n^2) each and the inverse at O(n^3) more, all without
+ * factoring again.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef FACTOR_H
+#define FACTOR_H
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "deter.h"
+#include "kernels.h"
+#include "matrix.h"
+
+namespace deter {
+
+  /**
+   * log|det(M)| and the sign of det(M), -1, 0 or 1; log is -inf for a singular matrix.
+   */
+  template<typename F>
+    struct log_determinant {
+      int sign;
+      F log;
+    };
+
+  /**
+   * P M = L U by factorBlockedLU, with the same pivots as factorLU. The factors are kept
+   * in one Matrix, which factor reuses from one matrix to the next.
+   */
+  template<typename F>
+    class Factorization {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      Matrix<F> lu;
+      std::vector<int> piv;
+      int sign = 1;
+
+      public:
+        Factorization() = default;
+
+        template<typename T>
+          explicit Factorization(const Matrix<T> &matrix) { factor(matrix); }
+
+        /**
+         * Factors a matrix, replacing the factors held so far.
+         *
+         * @param matrix - a square matrix.
+         */
+        template<typename T>
+          void factor(const Matrix<T> &matrix) {
+            const int n = matrix.order();
+            lu.resize(n);
+            lu.assign(matrix);
+            piv.resize(n);
+            sign = factorBlockedLU(n, lu.data(), lu.stride(), piv.data());
+          }
+
+        int order() const { return lu.order(); }
+
+        /**
+         * @return true if U has a zero on its diagonal.
+         */
+        bool singular() const {
+          for (int k=0; k < lu.order(); k++) {
+            if (lu(k, k) == 0) return true;
+          }
+          return false;
+        }
+
+        /**
+         * @return the determinant, the same value computeDeterminantBlocked gives.
+         */
+        F det() const {
+          if (lu.order() < 1) return 0;
+
+          F det = sign;
+          for (int k=0; k < lu.order(); k++) det *= lu(k, k);
+          if (det == 0) det = 0; // no negative zero in the report
+          return det;
+        }
+
+        /**
+         * @return log|det| as a sum of logs, which neither overflows nor underflows.
+         */
+        log_determinant<F> logdet() const {
+          if (lu.order() < 1) return { 0, -std::numeric_limits<F>::infinity() };
+
+          log_determinant<F> result = { sign, 0 };
+          for (int k=0; k < lu.order(); k++) {
+            const F u = lu(k, k);
+            if (u == 0) return { 0, -std::numeric_limits<F>::infinity() };
+            if (u < 0) result.sign = -result.sign;
+            result.log += std::log(std::abs(u));
+          }
+          return result;
+        }
+
+        /**
+         * Solves M X = B in place, for every column of B at once: the row swaps, then
+         * forward substitution with L and back substitution with U, a row of B at a time.
+         *
+         * @param b - the n x k right hand sides, overwritten by the solutions.
+         * @throw std::domain_error if the matrix is singular.
+         */
+        void solve(Matrix<F> &b) const {
+          const int n = lu.order(), k = b.cols();
+          if (b.rows() != n) throw std::invalid_argument("The right hand sides need " + std::to_string(n) + " rows");
+          if (singular()) throw std::domain_error("The matrix is singular");
+
+          for (int i=0; i < n; i++) {
+            if (piv[i] != i) std::swap_ranges(b.row(i), b.row(i) + k, b.row(piv[i]));
+          }
+
+          for (int i=1; i < n; i++) {
+            const F *l = lu.row(i);
+            for (int j=0; j < i; j++) {
+              if (l[j] != 0) eliminate(k, l[j], b.row(j), b.row(i));
+            }
+          }
+
+          for (int i=n-1; i >= 0; i--) {
+            const F *u = lu.row(i);
+            F *x = b.row(i);
+            for (int j=i+1; j < n; j++) {
+              if (u[j] != 0) eliminate(k, u[j], b.row(j), x);
+            }
+            for (int c=0; c < k; c++) x[c] /= u[i];
+          }
+        }
+
+        /**
+         * Solves M x = b in place for a single right hand side, by dot products along the
+         * rows of the factors.
+         *
+         * @param x - the n values of b, overwritten by the solution.
+         * @throw std::domain_error if the matrix is singular.
+         */
+        void solve(F *x) const {
+          const int n = lu.order();
+          if (singular()) throw std::domain_error("The matrix is singular");
+
+          for (int i=0; i < n; i++) std::swap(x[i], x[piv[i]]);
+
+          for (int i=1; i < n; i++) {
+            const F *l = lu.row(i);
+            F sum = x[i];
+            for (int j=0; j < i; j++) sum -= l[j] * x[j];
+            x[i] = sum;
+          }
+
+          for (int i=n-1; i >= 0; i--) {
+            const F *u = lu.row(i);
+            F sum = x[i];
+            for (int j=i+1; j < n; j++) sum -= u[j] * x[j];
+            x[i] = sum / u[i];
+          }
+        }
+
+        /**
+         * @return the inverse, the solution for the identity.
+         * @throw std::domain_error if the matrix is singular.
+         */
+        Matrix<F> inverse() const {
+          Matrix<F> x(lu.order());
+          for (int i=0; i < lu.order(); i++) x(i, i) = 1;
+          solve(x);
+          return x;
+        }
+    };
+
+  /**
+   * How many rank one updates IncrementalFactorization applies before it factors the
+   * matrix again, and how far the determinant may fall through updates (relative to the
+   * one last factored) before it does so at once, cancellation having set in.
+   */
+  const int UPDATE_REFRESH = 16;
+  const double UPDATE_DRIFT = 1e-8;
+
+  /**
+   * A Factorization of a matrix that then has rows and columns replaced. Replacing row i
+   * by r is adding e_i (r - a_i)^T, replacing column j by c is adding (c - a_j) e_j^T, and
+   * after t such updates A = A0 + U V^T. By the matrix determinant lemma in its general
+   * form,
+   *
+   *   det(A0 + U V^T) = det(A0) * det(I + V^T A0^-1 U)
+   *
+   * so every update costs one solve with the factors of A0 for the new column of
+   * W = A0^-1 U, the new row and column of the t x t capacitance matrix I + V^T W and its
+   * determinant: O(n^2) rather than O(n^3). After UPDATE_REFRESH updates, or once the
+   * determinant of the capacitance falls below UPDATE_DRIFT, the updated matrix is
+   * factored again so rounding cannot build up. A singular A0 has no inverse, every
+   * update factors again until the matrix is not.
+   */
+  template<typename F>
+    class IncrementalFactorization {
+      Matrix<F> a;      // the matrix as updated
+      Factorization<F> lu;  // of a when last factored
+      F base_det = 0;
+      log_determinant<F> base_log = { 0, 0 };
+      Matrix<F> w;      // row t is A0^-1 u_t
+      Matrix<F> v;      // row t is v_t
+      Matrix<F> c;      // the capacitance matrix
+      F cap_det = 1;
+      int updates = 0;
+      int factored = 0;
+
+      public:
+        /**
+         * Factors a matrix, dropping any updates.
+         */
+        template<typename T>
+          void factor(const Matrix<T> &matrix) {
+            a.resize(matrix.order());
+            a.assign(matrix);
+            refactor();
+          }
+
+        /**
+         * Factors the matrix as updated so far.
+         */
+        void refactor() {
+          const int n = a.order();
+          lu.factor(a);
+          base_det = lu.det();
+          base_log = lu.logdet();
+          w.resize(UPDATE_REFRESH, n);
+          v.resize(UPDATE_REFRESH, n);
+          c.resize(UPDATE_REFRESH, UPDATE_REFRESH);
+          cap_det = 1;
+          updates = 0;
+          factored++;
+        }
+
+        /**
+         * Replaces row i with the given n values.
+         */
+        template<typename T>
+          void replaceRow(const int i, const T *values) {
+            const int n = a.order();
+            if (!ready()) {
+              std::copy(values, values + n, a.row(i));
+              refactor();
+              return;
+            }
+
+            F *u = w.row(updates), *d = v.row(updates);
+            std::fill(u, u + n, F());
+            u[i] = 1;
+            F *row = a.row(i);
+            for (int j=0; j < n; j++) {
+              d[j] = (F) values[j] - row[j];
+              row[j] = (F) values[j];
+            }
+            add();
+          }
+
+        /**
+         * Replaces column j with the given n values, from the top down.
+         */
+        template<typename T>
+          void replaceColumn(const int j, const T *values) {
+            const int n = a.order();
+            if (!ready()) {
+              for (int i=0; i < n; i++) a(i, j) = values[i];
+              refactor();
+              return;
+            }
+
+            F *u = w.row(updates), *d = v.row(updates);
+            std::fill(d, d + n, F());
+            d[j] = 1;
+            for (int i=0; i < n; i++) {
+              u[i] = (F) values[i] - a(i, j);
+              a(i, j) = (F) values[i];
+            }
+            add();
+          }
+
+        const Matrix<F>& matrix() const { return a; }
+
+        /**
+         * @return the factors of the matrix as updated, factoring it again if it has been.
+         */
+        const Factorization<F>& factorization() {
+          if (updates > 0) refactor();
+          return lu;
+        }
+
+        /**
+         * @return how many times a matrix was factored, the first time included.
+         */
+        int factorizations() const { return factored; }
+
+        F det() const {
+          F det = base_det * cap_det;
+          if (det == 0) det = 0; // no negative zero in the report
+          return det;
+        }
+
+        log_determinant<F> logdet() const {
+          if (base_log.sign == 0 || cap_det == 0) return { 0, -std::numeric_limits<F>::infinity() };
+          return { (cap_det < 0) ? -base_log.sign : base_log.sign, base_log.log + std::log(std::abs(cap_det)) };
+        }
+
+      private:
+        /**
+         * @return true if the next update can be applied to the factors of A0.
+         */
+        bool ready() const {
+          return updates < UPDATE_REFRESH && !lu.singular();
+        }
+
+        /**
+         * Takes in the update in row t of w (u, solved here) and of v.
+         */
+        void add() {
+          const int n = a.order(), t = updates;
+          lu.solve(w.row(t));
+
+          // the capacitance grows by a row and a column, and is factored afresh
+          for (int x=0; x <= t; x++) {
+            for (int y=0; y <= t; y++) {
+              if (x < t && y < t) continue;
+              const F *vx = v.row(x), *wy = w.row(y);
+              F dot = (x == y) ? 1 : 0;
+              for (int k=0; k < n; k++) dot += vx[k] * wy[k];
+              c(x, y) = dot;
+            }
+          }
+
+          std::vector<F> cap((size_t) (t + 1) * (t + 1));
+          for (int x=0; x <= t; x++) std::copy(c.row(x), c.row(x) + t + 1, cap.begin() + ((t + 1) * x));
+
+          std::vector<int> piv(t + 1);
+          F det = factorLU(t + 1, cap.data(), t + 1, piv.data());
+          for (int k=0; k <= t; k++) det *= cap[((size_t) (t + 1) * k) + k];
+
+          cap_det = det;
+          updates++;
+          if (std::abs(cap_det) < UPDATE_DRIFT) refactor();
+        }
+    };
+
+  /**
+   * What read_factored reports for every matrix: the determinant and its log.
+   */
+  template<typename F>
+    struct factored {
+      F det;
+      log_determinant<F> logdet;
+    };
+
+  /**
+   * The determinant in a report followed by its log, as in
+   * "= det(M) = -3 log|det(M)| = 1.09861".
+   */
+  template<typename F>
+    void reportValue(std::ostream &outs, std::string &text, const factored<F> &deter, const int precision) {
+      reportValue(outs, text, deter.det, precision);
+      text += " log|det(M)| = ";
+      reportValue(outs, text, deter.logdet.log, precision);
+    }
+
+  /**
+   * Reports a matrix computed from a factorization, "title:" and its rows, or "title:
+   * none, the matrix is singular" when there is no such matrix.
+   *
+   * @param outs - the stream to output the result to.
+   * @param title - what the matrix is.
+   * @param x - the matrix, or nullptr when the matrix is singular.
+   */
+  template<typename F>
+    void reportFactored(std::ostream &outs, const std::string &title, const Matrix<F> *x) {
+      report_scratch &s = reportScratch();
+      const int precision = (int) outs.precision();
+      s.text += title;
+      s.text += ':';
+      if (x != nullptr) appendMatrix(s, *x, precision);
+      else s.text += " none, the matrix is singular";
+      s.text += "\n\n";
+      outs.write(s.text.data(), s.text.size());
+    }
+
+  /**
+   * Reports the determinant after an update, "Update (row 2) = det(M) = ... (0ms)".
+   *
+   * @param outs - the stream to output the result to.
+   * @param d - the update.
+   * @param deter - the determinant of the updated matrix.
+   */
+  template<typename F>
+    void reportUpdate(std::ostream &outs, const read_directive &d, const factored<F> &deter, std::chrono::milliseconds ms) {
+      report_scratch &s = reportScratch();
+      const int precision = (int) outs.precision();
+      s.text += (d.kind == update_row) ? "Update (row " : "Update (column ";
+      appendValue(s.text, d.count, precision);
+      s.text += ") = det(M) = ";
+      reportTail(outs, s.text, deter, ms, precision);
+      s.text += "\n\n";
+      outs.write(s.text.data(), s.text.size());
+    }
+
+  /**
+   * read_factored parses the input like read_matrices, factors every matrix once and
+   * reports its determinant and log|det|. The directives after a matrix are answered from
+   * the same factors: each "rhs k" block is solved and its solution reported, each update
+   * of a row or column is applied by IncrementalFactorization and the new determinant
+   * reported, and the inverse is reported when asked for. Right hand sides after updates
+   * are solved for the updated matrix, which is factored again for them.
+   *
+   * @param s - the input stream containing the matrix data to read.
+   * @param o - the output stream to write the result data to.
+   * @param inverse - true to report the inverse of every matrix.
+   * @param report - a reporting function for the matrix and its determinants.
+   *
+   * @return an overall status, 0 being success and non-zero signaling failure.
+   */
+  template<typename T, typename In>
+    int read_factored(
+        In &s,
+        std::ostream &o,
+        const bool inverse,
+        typename identity<std::function<void(std::ostream &o, const Matrix<T>&, const factored<double>, std::chrono::milliseconds)>>::type report) {
+
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      IncrementalFactorization<double> lu;
+      Matrix<double> x;
+
+      auto now = []() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+      };
+
+      auto factor_and_report = [&](Matrix<T> &m) {
+        std::chrono::milliseconds start = now();
+        lu.factor(m);
+        const factored<double> value = { lu.det(), lu.logdet() };
+        std::chrono::milliseconds end = now();
+
+        report(o, m, value, end - start);
+        if (inverse) {
+          const Factorization<double> &f = lu.factorization();
+          if (f.singular()) {
+            reportFactored<double>(o, "Inverse", nullptr);
+          } else {
+            Matrix<double> inv = f.inverse();
+            reportFactored(o, "Inverse", &inv);
+          }
+        }
+        return true;
+      };
+
+      auto on_directive = [&](const read_directive &d, Matrix<T> &b) {
+        if (d.kind != rhs_block) {
+          std::chrono::milliseconds start = now();
+          if (d.kind == update_row) lu.replaceRow(d.count, b.row(0));
+          else lu.replaceColumn(d.count, b.row(0));
+          const factored<double> value = { lu.det(), lu.logdet() };
+          std::chrono::milliseconds end = now();
+
+          reportUpdate(o, d, value, end - start);
+          return true;
+        }
+
+        const std::string title = "Solution (size: " + std::to_string(b.rows()) + " x " + std::to_string(d.count) + ")";
+        const Factorization<double> &f = lu.factorization();
+        if (f.singular()) {
+          reportFactored<double>(o, title, nullptr);
+          return true;
+        }
+
+        x.resize(b.rows(), b.cols());
+        x.assign(b);
+        f.solve(x);
+        reportFactored(o, title, &x);
+        return true;
+      };
+
+      auto report_error = [&](const std::string &msg, const char &badc) {
+        reportError(o, msg, badc);
+      };
+
+      return parse_matrices<T>(s, factor_and_report, report_error, on_directive);
+    }
+
+}
+
+#endif
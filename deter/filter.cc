@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <stdexcept>
+
+#include "filter.h"
+
+/**
+ * Implementation for the certified sign: the error bound of the floating point filter and
+ * the exact arithmetic on dyadic values behind it.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+  typedef unsigned __int128 u128;
+
+  /**
+   * The magnitudes the filter accepts in A and in its factors: their squares, and the
+   * products of two of them, are normal doubles, so every rounding is a relative one.
+   */
+  const double FILTER_LOW = 0x1p-450;
+  const double FILTER_HIGH = 0x1p450;
+
+  bool inRange(const double v) {
+    const double a = std::abs(v);
+    return a == 0 || (a >= FILTER_LOW && a <= FILTER_HIGH);
+  }
+
+  /**
+   * A product kept as a mantissa and a power of two, so it neither overflows nor
+   * underflows however many factors it has.
+   */
+  struct scaled {
+    double m = 1;
+    long e = 0;
+
+    void mul(const double v) {
+      int x;
+      m = std::frexp(m * v, &x);
+      e += x;
+    }
+  };
+
+  uint64_t pow2mod(int e, uint64_t p) {
+    uint64_t r = 1, a = 2;
+    for (; e; e >>= 1) {
+      if (e & 1) r = (uint64_t) (((u128) r * a) % p);
+      a = (uint64_t) (((u128) a * a) % p);
+    }
+    return r;
+  }
+}
+
+bool deter::filteredSign(const Matrix<double> &matrix, int &sign) {
+  const int n = matrix.order();
+  const double u = std::numeric_limits<double>::epsilon() / 2;
+  if (4.0 * n * (n + 3) * u >= 0.01) return false; // the slack below would not hold
+
+  // the norms of the rows of A, a row of zeros settles it at once
+  Matrix<double> a(n);
+  a.assign(matrix);
+  std::vector<double> norm(n);
+  for (int i=0; i < n; i++) {
+    const double *row = a.row(i);
+    double sum = 0;
+    for (int j=0; j < n; j++) {
+      if (!inRange(row[j])) return false;
+      sum += row[j] * row[j];
+    }
+    if (sum == 0) {
+      sign = 0;
+      return true;
+    }
+    norm[i] = std::sqrt(sum);
+  }
+
+  std::vector<int> piv(n);
+  int det_sign = factorLU(n, a.data(), a.stride(), piv.data());
+
+  // the row of A each row of the factors came from
+  std::vector<int> from(n);
+  for (int i=0; i < n; i++) from[i] = i;
+  for (int k=0; k < n; k++) std::swap(from[k], from[piv[k]]);
+
+  // the norms of the rows of U, the sign of det(B) and |det(B)| / prod ||a_i||
+  std::vector<double> unorm(n);
+  scaled ratio;
+  for (int k=0; k < n; k++) {
+    const double *row = a.row(k);
+    if (row[k] == 0) return false;
+
+    double sum = 0;
+    for (int j=0; j < n; j++) {
+      if (!inRange(row[j])) return false;
+      if (j >= k) sum += row[j] * row[j];
+    }
+    unorm[k] = std::sqrt(sum);
+
+    if (row[k] < 0) det_sign = -det_sign;
+    ratio.mul(std::abs(row[k]) / norm[from[k]]);
+  }
+
+  // r = sum ||e_i|| / ||a_i||, each ||e_i|| at most gamma_n * sum_k |l_ik| ||u_k||, and
+  // prod (1 + r_i) - 1 <= exp(r) - 1 <= r (1 + r) for r <= 1
+  const double gamma = ((n + 1) * u) / (1 - ((n + 1) * u));
+  double r = 0;
+  for (int i=0; i < n; i++) {
+    const double *row = a.row(i);
+    double s = unorm[i];
+    for (int k=0; k < i; k++) s += std::abs(row[k]) * unorm[k];
+    r += (gamma * s) / norm[from[i]];
+  }
+
+  // r is a chain of at most 5n + 8 roundings of non-negative values, the ratio a product
+  // of n quotients with n + 3 roundings each, and (1 + u)^k <= 1 + 2ku while ku is small
+  r *= 1 + (16.0 * (n + 2) * u);
+  if (r > 1 || ratio.e < -1000) return false;
+
+  const double lower = std::ldexp(ratio.m, (int) std::min(ratio.e, 2000L)) * (1 - (4.0 * n * (n + 3) * u));
+  if (lower <= r * (1 + r)) return false;
+
+  sign = det_sign;
+  return true;
+}
+
+int deter::exactSign(const Matrix<double> &matrix, ThreadPool *pool) {
+  const int n = matrix.order();
+  if (n < 1) return 0;
+
+  // every value as an odd mantissa times a power of two, then every row shifted so its
+  // smallest power is 2^0
+  std::vector<int64_t> mant((size_t) n * n, 0);
+  std::vector<int> shift((size_t) n * n, 0);
+  int widest = 0;
+  double bound = 0; // log2 of Hadamard's bound for the scaled matrix, from above
+  for (int i=0; i < n; i++) {
+    const double *row = matrix.row(i);
+    int64_t *m = mant.data() + ((size_t) n * i);
+    int *s = shift.data() + ((size_t) n * i);
+
+    int low = INT_MAX;
+    for (int j=0; j < n; j++) {
+      if (!std::isfinite(row[j])) {
+        throw std::invalid_argument("The matrix holds a value that is not finite: " + std::to_string(row[j]));
+      }
+      if (row[j] == 0) continue;
+
+      int e;
+      int64_t v = (int64_t) std::ldexp(std::frexp(row[j], &e), 53);
+      const int zeros = __builtin_ctzll((uint64_t) ((v < 0) ? -v : v));
+      m[j] = v / ((int64_t) 1 << zeros);
+      s[j] = e - 53 + zeros;
+      low = std::min(low, s[j]);
+    }
+    if (low == INT_MAX) return 0; // a row of zeros
+
+    int bits = 0;
+    for (int j=0; j < n; j++) {
+      if (m[j] == 0) continue;
+      s[j] -= low;
+      const uint64_t mag = (uint64_t) ((m[j] < 0) ? -m[j] : m[j]);
+      bits = std::max(bits, 64 - __builtin_clzll(mag) + s[j]);
+    }
+    widest = std::max(widest, bits);
+    bound += bits + (0.5 * std::log2((double) n));
+  }
+
+  // the common case: the scaled values fit the integer engines
+  if (widest <= 62) {
+    std::vector<int64_t> a((size_t) n * n);
+    for (size_t k=0; k < a.size(); k++) a[k] = mant[k] * ((int64_t) 1 << shift[k]);
+    return exactDeterminant(n, a.data(), pool).sign();
+  }
+
+  // otherwise modulo enough primes, the residue of m * 2^s being (m mod p) * (2^s mod p)
+  const size_t count = (size_t) std::ceil((bound + 2) / 61.99);
+  const std::vector<uint64_t> primes = modularPrimes(count);
+  std::vector<uint64_t> residues(count);
+  auto solve = [&](long x) {
+    const uint64_t p = primes[x];
+    std::vector<int64_t> a((size_t) n * n);
+    for (size_t k=0; k < a.size(); k++) {
+      if (mant[k] == 0) { a[k] = 0; continue; }
+      int64_t r = mant[k] % (int64_t) p;
+      if (r < 0) r += (int64_t) p;
+      a[k] = (int64_t) (((u128) r * pow2mod(shift[k], p)) % p);
+    }
+    residues[x] = determinantModP(n, a.data(), p);
+  };
+
+  if (pool != nullptr && count > 1) {
+    pool->parallel_for(0, (long) count, solve);
+  } else {
+    for (size_t x=0; x < count; x++) solve((long) x);
+  }
+
+  return reconstructCRT(residues, primes).sign();
+}
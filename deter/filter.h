@@ -0,0 +1,139 @@
+/**
+ * The sign of the determinant, certified. Singularity and orientation tests only need to
+ * know whether det(M) is negative, zero or positive, and need to know it for sure. The
+ * matrix is factored by LU in floating point, and a forward error bound on the result,
+ * computed alongside in O(n^2), decides whether the sign of the floating point
+ * determinant can be trusted. Only when it cannot (the determinant is zero or close to
+ * it, or the factors over- or underflow) is the sign found by exact arithmetic on the
+ * values of the matrix, which are all dyadic rationals.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "deter.h"
+#include "exact.h"
+#include "matrix.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * The sign of a determinant, -1, 0 or 1, and whether it took the exact engine.
+   */
+  struct certified_sign {
+    int sign = 0;
+    bool exact = false;
+  };
+
+  /**
+   * The floating point filter. The matrix is factored as P A = L U by factorLU, and by
+   * the backward error of Gaussian elimination (Higham, Accuracy and Stability of
+   * Numerical Algorithms, Theorem 9.3) B = P^T L U is A + E with |E| <= gamma_n P^T |L| |U|.
+   * det(B) is the sign of P times the product of the diagonal of U, whose sign is exact.
+   * Expanding det(A + E) by rows and bounding every term by Hadamard's inequality gives
+   *
+   *   |det(B) - det(A)| <= prod (||a_i|| + ||e_i||) - prod ||a_i||
+   *
+   * and where that is below |det(B)| the two determinants have the same sign. The norms
+   * are computed in floating point and every rounding in them is accounted for, so the
+   * answer is certain; it is there for a determinant not too close to zero relative to
+   * the rows of the matrix, which is all but degenerate input at small and moderate
+   * orders.
+   *
+   * @param matrix - the matrix.
+   * @param sign - receives the sign when it is certain.
+   * @return false if the filter cannot tell.
+   */
+  bool filteredSign(const Matrix<double> &matrix, int &sign);
+
+  /**
+   * The exact sign of the determinant. Every row is scaled by a power of two that makes
+   * its values integers, which does not change the sign. When they fit 62 bits they go
+   * to exactDeterminant, otherwise to multi-modular elimination with the residues of the
+   * scaled values taken directly from their mantissas and exponents.
+   *
+   * @param matrix - the matrix.
+   * @param pool - threads for the multi-modular elimination, or nullptr to run on the calling thread.
+   * @return the sign of the determinant.
+   * @throw std::invalid_argument if the matrix holds a value that is not finite.
+   */
+  int exactSign(const Matrix<double> &matrix, ThreadPool *pool);
+
+  /**
+   * The certified sign of the determinant: filteredSign, and exactSign when the filter
+   * cannot tell. Integer matrices with values beyond 2^53, which double does not hold,
+   * go to exactDeterminant directly.
+   *
+   * @param matrix - the matrix.
+   * @param pool - threads for the exact engine, or nullptr to run on the calling thread.
+   * @return the sign and the path that found it.
+   */
+  template<typename T>
+    certified_sign certifySign(const Matrix<T> &matrix, ThreadPool *pool) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+
+      certified_sign result;
+      if (matrix.order() < 1) return result;
+
+      if constexpr (std::is_integral<T>::value) {
+        const int n = matrix.order();
+        bool fits = true;
+        for (int i=0; i < n && fits; i++) {
+          const T *row = matrix.row(i);
+          for (int j=0; j < n; j++) fits = fits && (T) (double) row[j] == row[j];
+        }
+
+        if (!fits) {
+          std::vector<int64_t> a;
+          toInteger(matrix, a);
+          result.sign = exactDeterminant(n, a.data(), pool).sign();
+          result.exact = true;
+          return result;
+        }
+
+        Matrix<double> m(n);
+        m.assign(matrix);
+        return certifySign(m, pool);
+      } else {
+        if constexpr (std::is_same<T, double>::value) {
+          if (filteredSign(matrix, result.sign)) return result;
+          result.sign = exactSign(matrix, pool);
+        } else {
+          Matrix<double> m(matrix.order());
+          m.assign(matrix);
+          if (filteredSign(m, result.sign)) return result;
+          result.sign = exactSign(m, pool);
+        }
+        result.exact = true;
+        return result;
+      }
+    }
+
+  /**
+   * certifySign on the calling thread, with the compute callback signature.
+   */
+  template<typename T>
+    certified_sign computeSignCertified(const Matrix<T> &matrix) {
+      return certifySign(matrix, nullptr);
+    }
+
+  /**
+   * The sign in a report followed by the path that found it, as in "= det(M) = -1 [filter]".
+   */
+  inline void reportValue(std::ostream &outs, std::string &text, const certified_sign &deter, const int precision) {
+    reportValue(outs, text, deter.sign, precision);
+    text += deter.exact ? " [exact]" : " [filter]";
+  }
+
+}
+
+#endif
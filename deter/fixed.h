@@ -0,0 +1,175 @@
+/**
+ * Determinant kernels specialized on the order of the matrix, for the small orders most
+ * matrices have. With the order a template parameter the matrix sits in an std::array,
+ * the index lists of the expansion live on the stack and every loop has a constant trip
+ * count the compiler unrolls. Each kernel does exactly the arithmetic of the general
+ * engine it stands in for, in the same order, so the results are the same to the bit.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+namespace deter {
+
+  /**
+   * The orders with a specialized kernel.
+   */
+  const int FIXED_MIN = 2;
+  const int FIXED_MAX = 8;
+
+  /**
+   * The cofactor expansion of cofactorExpansion over a K x K sub-matrix of an N x N
+   * matrix, with the recursion unrolled on K.
+   */
+  template<typename T, int N, int K>
+    struct fixed_expansion {
+      static T expand(const T *m, const int *rws, const int *cls) {
+        // pick the sparsest line, rows first so a dense matrix expands along its first row
+        int line = 0, most = -1;
+        bool by_row = true;
+        for (int i=0; i < K; i++) {
+          const T *r = m + (N * rws[i]);
+          int zeros = 0;
+          for (int j=0; j < K; j++) zeros += (r[cls[j]] == 0);
+          if (zeros > most) { most = zeros; line = i; }
+        }
+        for (int j=0; j < K; j++) {
+          int zeros = 0;
+          for (int i=0; i < K; i++) zeros += (m[(N * rws[i]) + cls[j]] == 0);
+          if (zeros > most) { most = zeros; line = j; by_row = false; }
+        }
+
+        if (most == K) return 0; // a line of zeros
+
+        int child_rws[K - 1], child_cls[K - 1];
+        const int *fixed = by_row ? rws : cls;
+        const int *other = by_row ? cls : rws;
+        int *child_fixed = by_row ? child_rws : child_cls;
+        int *child_other = by_row ? child_cls : child_rws;
+
+        for (int i=0, x=0; i < K; i++) {
+          if (i != line) child_fixed[x++] = fixed[i];
+        }
+
+        T sum = 0;
+        for (int j=0; j < K; j++) {
+          T v = by_row ? m[(N * fixed[line]) + other[j]] : m[(N * other[j]) + fixed[line]];
+          if (v == 0) continue; // skip
+
+          for (int i=0, x=0; i < K; i++) {
+            if (i != j) child_other[x++] = other[i];
+          }
+
+          T term = v * fixed_expansion<T, N, K - 1>::expand(m, child_rws, child_cls);
+          sum += ((line + j) % 2 == 0) ? term : -term;
+        }
+
+        return sum;
+      }
+    };
+
+  template<typename T, int N>
+    struct fixed_expansion<T, N, 2> {
+      static T expand(const T *m, const int *rws, const int *cls) {
+        const T *r0 = m + (N * rws[0]), *r1 = m + (N * rws[1]);
+        return (r1[cls[1]] * r0[cls[0]]) - (r0[cls[1]] * r1[cls[0]]);
+      }
+    };
+
+  /**
+   * computeDeterminant for an N x N matrix.
+   *
+   * @param m - the matrix data.
+   * @param ld - the distance between the start of consecutive rows.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T, int N>
+    T fixedCofactor(const T *m, const int ld) {
+      std::array<T, N * N> a;
+      for (int i=0; i < N; i++) std::copy(m + (ld * i), m + (ld * i) + N, a.begin() + (N * i));
+
+      std::array<int, N> idx;
+      for (int i=0; i < N; i++) idx[i] = i;
+      return fixed_expansion<T, N, N>::expand(a.data(), idx.data(), idx.data());
+    }
+
+  /**
+   * computeDeterminantLU for an N x N matrix: factorLU with its pivoting and the product
+   * of the diagonal. The row updates are the plain loops, so the result is that of the
+   * scalar kernels (-k scalar).
+   *
+   * @param m - the matrix data.
+   * @param ld - the distance between the start of consecutive rows.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T, int N>
+    T fixedLU(const T *m, const int ld) {
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+      std::array<F, N * N> a;
+      for (int i=0; i < N; i++) std::copy(m + (ld * i), m + (ld * i) + N, a.begin() + (N * i));
+
+      int sign = 1;
+      for (int k=0; k < N; k++) {
+        int p = k;
+        F best = std::abs(a[(N * k) + k]);
+        for (int i=k+1; i < N; i++) {
+          F v = std::abs(a[(N * i) + k]);
+          if (v > best) { best = v; p = i; }
+        }
+
+        if (best == 0) continue; // nothing to eliminate
+
+        if (p != k) {
+          std::swap_ranges(a.begin() + (N * k), a.begin() + (N * k) + N, a.begin() + (N * p));
+          sign = -sign;
+        }
+
+        for (int i=k+1; i < N; i++) {
+          F l = a[(N * i) + k] / a[(N * k) + k];
+          a[(N * i) + k] = l;
+          if (l == 0) continue;
+          for (int j=k+1; j < N; j++) a[(N * i) + j] -= l * a[(N * k) + j];
+        }
+      }
+
+      F det = sign;
+      for (int k=0; k < N; k++) det *= a[(N * k) + k];
+      if (det == 0) det = 0; // no negative zero in the report
+
+      if (std::is_integral<T>::value) return static_cast<T>(std::llround(det));
+      return static_cast<T>(det);
+    }
+
+  /**
+   * Runs a kernel specialized on the order when there is one for the given order.
+   *
+   * @param size - the order of the matrix.
+   * @param kernel - called with an std::integral_constant<int, N> holding the order.
+   * @param det - receives what the kernel returns.
+   * @return false if there is no kernel for the order.
+   */
+  template<typename T, typename Kernel>
+    bool fixedOrder(const int size, Kernel kernel, T &det) {
+      switch (size) {
+        case 2: det = kernel(std::integral_constant<int, 2>()); return true;
+        case 3: det = kernel(std::integral_constant<int, 3>()); return true;
+        case 4: det = kernel(std::integral_constant<int, 4>()); return true;
+        case 5: det = kernel(std::integral_constant<int, 5>()); return true;
+        case 6: det = kernel(std::integral_constant<int, 6>()); return true;
+        case 7: det = kernel(std::integral_constant<int, 7>()); return true;
+        case 8: det = kernel(std::integral_constant<int, 8>()); return true;
+        default: return false;
+      }
+    }
+
+}
+
+#endif
@@ -0,0 +1,15 @@
+#include "format.h"
+
+/**
+ * Implementation for the report formatting.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+deter::report_scratch& deter::reportScratch() {
+  thread_local report_scratch scratch;
+  scratch.text.clear();
+  scratch.values.clear();
+  scratch.lengths.clear();
+  return scratch;
+}
@@ -0,0 +1,102 @@
+/**
+ * Number formatting for the reports, with std::to_chars into caller buffers instead of
+ * std::to_string and stream insertion, so echoing a large matrix allocates nothing. The
+ * results are the characters the stream formatting gave, byte for byte.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace deter {
+
+  /**
+   * Room for any value formatted below, a long double in fixed notation being the longest.
+   */
+  const size_t FORMAT_MAX = 5000;
+
+  /**
+   * The size of the buffer given to output files.
+   */
+  const size_t OUTPUT_BUFFER = 1 << 20;
+
+  /**
+   * is_formattable tells which value types the functions below handle, the others are
+   * reported through their stream operators.
+   */
+  template<typename T>
+    struct is_formattable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> { };
+
+  /**
+   * The width a value was padded to in the matrix echo: the length of std::to_string of
+   * the value with its trailing zeros and then its trailing point removed. (Integers lose
+   * their trailing zeros too, as they always have.)
+   *
+   * @param v - the value.
+   * @return its width.
+   */
+  template<typename T>
+    int trimmedWidth(const T v) {
+      char buf[FORMAT_MAX];
+      char *end;
+      if constexpr (std::is_floating_point<T>::value) end = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, 6).ptr;
+      else end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+
+      while (end > buf && end[-1] == '0') end--;
+      while (end > buf && end[-1] == '.') end--;
+      return (int) (end - buf);
+    }
+
+  /**
+   * Formats a value the way operator<< of a stream with default flags does: floating
+   * point as %g with the given precision, integers in decimal.
+   *
+   * @param first - the buffer, at least FORMAT_MAX characters.
+   * @param v - the value.
+   * @param precision - the precision of the stream.
+   * @return the end of the characters written.
+   */
+  template<typename T>
+    char* formatValue(char *first, const T v, const int precision) {
+      if constexpr (std::is_floating_point<T>::value) {
+        // the stream prints floats promoted to double, which holds them exactly
+        return std::to_chars(first, first + FORMAT_MAX, v, std::chars_format::general, precision == 0 ? 1 : precision).ptr;
+      } else {
+        return std::to_chars(first, first + FORMAT_MAX, v).ptr;
+      }
+    }
+
+  /**
+   * Appends a value formatted by formatValue.
+   */
+  template<typename T>
+    void appendValue(std::string &out, const T v, const int precision) {
+      char buf[FORMAT_MAX];
+      out.append(buf, formatValue(buf, v, precision) - buf);
+    }
+
+  /**
+   * The buffers a report is built in, kept per thread so their capacity carries over from
+   * one report to the next.
+   */
+  struct report_scratch {
+    std::string text;                    // the report
+    std::string values;                  // the formatted values of the matrix, back to back
+    std::vector<unsigned char> lengths;  // the length of each of them
+  };
+
+  /**
+   * @return the report buffers of this thread, emptied.
+   */
+  report_scratch& reportScratch();
+
+}
+
+#endif
@@ -0,0 +1,351 @@
+#include <atomic>
+
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DETER_X86 1
+#endif
+
+/**
+ * Implementation of the row elimination kernels. Each instruction set gets its own
+ * compiled copy of the kernels (through the target attribute, so no special compiler
+ * flags are needed) and a table of function pointers per level. The table in use is
+ * swapped atomically, the kernels themselves are free functions with no state.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+
+  struct kernel_table {
+    deter::isa level;
+    void (*eliminate_d)(const int, const double, const double*, double*);
+    void (*eliminate_f)(const int, const float, const float*, float*);
+    void (*eliminate4_d)(const int, const double*, const double*, const double*, const double*, const double*, double*);
+    void (*eliminate4_f)(const int, const float*, const float*, const float*, const float*, const float*, float*);
+    int lanes;
+    void (*determinant_lanes)(const int, double*, double*);
+  };
+
+  void determinant_lanes_scalar(const int n, double *a, double *det) {
+    deter::determinantLanes<double>(4, n, a, det);
+  }
+
+  const kernel_table scalar_table = {
+    deter::scalar,
+    &deter::eliminate<double>,
+    &deter::eliminate<float>,
+    &deter::eliminate4<double>,
+    &deter::eliminate4<float>,
+    4,
+    &determinant_lanes_scalar
+  };
+
+#ifdef DETER_X86
+  __attribute__((target("avx2,fma")))
+  void eliminate_avx2(const int n, const double l, const double *x, double *y) {
+    const __m256d vl = _mm256_set1_pd(l);
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+      _mm256_storeu_pd(y + j, _mm256_fnmadd_pd(vl, _mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j)));
+    }
+    for (; j < n; j++) y[j] -= l * x[j];
+  }
+
+  __attribute__((target("avx2,fma")))
+  void eliminate_avx2(const int n, const float l, const float *x, float *y) {
+    const __m256 vl = _mm256_set1_ps(l);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+      _mm256_storeu_ps(y + j, _mm256_fnmadd_ps(vl, _mm256_loadu_ps(x + j), _mm256_loadu_ps(y + j)));
+    }
+    for (; j < n; j++) y[j] -= l * x[j];
+  }
+
+  __attribute__((target("avx2,fma")))
+  void eliminate4_avx2(const int n, const double *l, const double *x0, const double *x1,
+      const double *x2, const double *x3, double *y) {
+    const __m256d l0 = _mm256_set1_pd(l[0]), l1 = _mm256_set1_pd(l[1]);
+    const __m256d l2 = _mm256_set1_pd(l[2]), l3 = _mm256_set1_pd(l[3]);
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+      __m256d t = _mm256_mul_pd(l0, _mm256_loadu_pd(x0 + j));
+      t = _mm256_fmadd_pd(l1, _mm256_loadu_pd(x1 + j), t);
+      t = _mm256_fmadd_pd(l2, _mm256_loadu_pd(x2 + j), t);
+      t = _mm256_fmadd_pd(l3, _mm256_loadu_pd(x3 + j), t);
+      _mm256_storeu_pd(y + j, _mm256_sub_pd(_mm256_loadu_pd(y + j), t));
+    }
+    for (; j < n; j++) y[j] -= (l[0] * x0[j] + l[1] * x1[j]) + (l[2] * x2[j] + l[3] * x3[j]);
+  }
+
+  __attribute__((target("avx2,fma")))
+  void eliminate4_avx2(const int n, const float *l, const float *x0, const float *x1,
+      const float *x2, const float *x3, float *y) {
+    const __m256 l0 = _mm256_set1_ps(l[0]), l1 = _mm256_set1_ps(l[1]);
+    const __m256 l2 = _mm256_set1_ps(l[2]), l3 = _mm256_set1_ps(l[3]);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+      __m256 t = _mm256_mul_ps(l0, _mm256_loadu_ps(x0 + j));
+      t = _mm256_fmadd_ps(l1, _mm256_loadu_ps(x1 + j), t);
+      t = _mm256_fmadd_ps(l2, _mm256_loadu_ps(x2 + j), t);
+      t = _mm256_fmadd_ps(l3, _mm256_loadu_ps(x3 + j), t);
+      _mm256_storeu_ps(y + j, _mm256_sub_ps(_mm256_loadu_ps(y + j), t));
+    }
+    for (; j < n; j++) y[j] -= (l[0] * x0[j] + l[1] * x1[j]) + (l[2] * x2[j] + l[3] * x3[j]);
+  }
+
+  __attribute__((target("avx512f")))
+  void eliminate_avx512(const int n, const double l, const double *x, double *y) {
+    const __m512d vl = _mm512_set1_pd(l);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+      _mm512_storeu_pd(y + j, _mm512_fnmadd_pd(vl, _mm512_loadu_pd(x + j), _mm512_loadu_pd(y + j)));
+    }
+    if (j < n) {
+      const __mmask8 k = (__mmask8) ((1u << (n - j)) - 1);
+      __m512d vy = _mm512_maskz_loadu_pd(k, y + j);
+      _mm512_mask_storeu_pd(y + j, k, _mm512_fnmadd_pd(vl, _mm512_maskz_loadu_pd(k, x + j), vy));
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  void eliminate_avx512(const int n, const float l, const float *x, float *y) {
+    const __m512 vl = _mm512_set1_ps(l);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+      _mm512_storeu_ps(y + j, _mm512_fnmadd_ps(vl, _mm512_loadu_ps(x + j), _mm512_loadu_ps(y + j)));
+    }
+    if (j < n) {
+      const __mmask16 k = (__mmask16) ((1u << (n - j)) - 1);
+      __m512 vy = _mm512_maskz_loadu_ps(k, y + j);
+      _mm512_mask_storeu_ps(y + j, k, _mm512_fnmadd_ps(vl, _mm512_maskz_loadu_ps(k, x + j), vy));
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  void eliminate4_avx512(const int n, const double *l, const double *x0, const double *x1,
+      const double *x2, const double *x3, double *y) {
+    const __m512d l0 = _mm512_set1_pd(l[0]), l1 = _mm512_set1_pd(l[1]);
+    const __m512d l2 = _mm512_set1_pd(l[2]), l3 = _mm512_set1_pd(l[3]);
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+      __m512d t = _mm512_mul_pd(l0, _mm512_loadu_pd(x0 + j));
+      t = _mm512_fmadd_pd(l1, _mm512_loadu_pd(x1 + j), t);
+      t = _mm512_fmadd_pd(l2, _mm512_loadu_pd(x2 + j), t);
+      t = _mm512_fmadd_pd(l3, _mm512_loadu_pd(x3 + j), t);
+      _mm512_storeu_pd(y + j, _mm512_sub_pd(_mm512_loadu_pd(y + j), t));
+    }
+    for (; j < n; j++) y[j] -= (l[0] * x0[j] + l[1] * x1[j]) + (l[2] * x2[j] + l[3] * x3[j]);
+  }
+
+  __attribute__((target("avx512f")))
+  void eliminate4_avx512(const int n, const float *l, const float *x0, const float *x1,
+      const float *x2, const float *x3, float *y) {
+    const __m512 l0 = _mm512_set1_ps(l[0]), l1 = _mm512_set1_ps(l[1]);
+    const __m512 l2 = _mm512_set1_ps(l[2]), l3 = _mm512_set1_ps(l[3]);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+      __m512 t = _mm512_mul_ps(l0, _mm512_loadu_ps(x0 + j));
+      t = _mm512_fmadd_ps(l1, _mm512_loadu_ps(x1 + j), t);
+      t = _mm512_fmadd_ps(l2, _mm512_loadu_ps(x2 + j), t);
+      t = _mm512_fmadd_ps(l3, _mm512_loadu_ps(x3 + j), t);
+      _mm512_storeu_ps(y + j, _mm512_sub_ps(_mm512_loadu_ps(y + j), t));
+    }
+    for (; j < n; j++) y[j] -= (l[0] * x0[j] + l[1] * x1[j]) + (l[2] * x2[j] + l[3] * x3[j]);
+  }
+
+  // one matrix per lane, the steps of determinantLanes<double> with masks in place of
+  // branches; fp-contract=off keeps the multiply and subtract apart, as in the scalar loops
+  __attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+  void determinant_lanes_avx2(const int n, double *a, double *det) {
+    const int W = 4;
+    const __m256d zero = _mm256_setzero_pd(), negative = _mm256_set1_pd(-0.0);
+    __m256d sign = _mm256_set1_pd(1.0);
+
+    for (int k=0; k < n; k++) {
+      double *rk = a + (n * k * W);
+      __m256d best = _mm256_andnot_pd(negative, _mm256_loadu_pd(rk + (k * W)));
+      __m256d p = _mm256_set1_pd(k);
+      for (int i=k+1; i < n; i++) {
+        __m256d v = _mm256_andnot_pd(negative, _mm256_loadu_pd(a + (((n * i) + k) * W)));
+        __m256d more = _mm256_cmp_pd(v, best, _CMP_GT_OQ);
+        best = _mm256_blendv_pd(best, v, more);
+        p = _mm256_blendv_pd(p, _mm256_set1_pd(i), more);
+      }
+      const __m256d live = _mm256_cmp_pd(best, zero, _CMP_NEQ_UQ);
+
+      for (int i=k+1; i < n; i++) {
+        const __m256d swap = _mm256_and_pd(live, _mm256_cmp_pd(p, _mm256_set1_pd(i), _CMP_EQ_OQ));
+        if (_mm256_movemask_pd(swap) == 0) continue;
+
+        double *ri = a + (n * i * W);
+        for (int j=0; j < n; j++) {
+          __m256d x = _mm256_loadu_pd(rk + (j * W)), y = _mm256_loadu_pd(ri + (j * W));
+          _mm256_storeu_pd(rk + (j * W), _mm256_blendv_pd(x, y, swap));
+          _mm256_storeu_pd(ri + (j * W), _mm256_blendv_pd(y, x, swap));
+        }
+        sign = _mm256_xor_pd(sign, _mm256_and_pd(swap, negative));
+      }
+
+      const __m256d pivot = _mm256_loadu_pd(rk + (k * W));
+      for (int i=k+1; i < n; i++) {
+        double *ri = a + (n * i * W);
+        const __m256d x = _mm256_loadu_pd(ri + (k * W));
+        const __m256d l = _mm256_div_pd(x, pivot);
+        _mm256_storeu_pd(ri + (k * W), _mm256_blendv_pd(x, l, live));
+
+        const __m256d update = _mm256_and_pd(live, _mm256_cmp_pd(l, zero, _CMP_NEQ_UQ));
+        if (_mm256_movemask_pd(update) == 0) continue;
+        for (int j=k+1; j < n; j++) {
+          __m256d y = _mm256_loadu_pd(ri + (j * W));
+          __m256d ny = _mm256_sub_pd(y, _mm256_mul_pd(l, _mm256_loadu_pd(rk + (j * W))));
+          _mm256_storeu_pd(ri + (j * W), _mm256_blendv_pd(y, ny, update));
+        }
+      }
+    }
+
+    __m256d d = sign;
+    for (int k=0; k < n; k++) d = _mm256_mul_pd(d, _mm256_loadu_pd(a + (((n * k) + k) * W)));
+    _mm256_storeu_pd(det, _mm256_blendv_pd(d, zero, _mm256_cmp_pd(d, zero, _CMP_EQ_OQ)));
+  }
+
+  __attribute__((target("avx512f"), optimize("fp-contract=off")))
+  void determinant_lanes_avx512(const int n, double *a, double *det) {
+    const int W = 8;
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d sign = _mm512_set1_pd(1.0);
+
+    for (int k=0; k < n; k++) {
+      double *rk = a + (n * k * W);
+      __m512d best = _mm512_abs_pd(_mm512_loadu_pd(rk + (k * W)));
+      __m512d p = _mm512_set1_pd(k);
+      for (int i=k+1; i < n; i++) {
+        __m512d v = _mm512_abs_pd(_mm512_loadu_pd(a + (((n * i) + k) * W)));
+        __mmask8 more = _mm512_cmp_pd_mask(v, best, _CMP_GT_OQ);
+        best = _mm512_mask_blend_pd(more, best, v);
+        p = _mm512_mask_blend_pd(more, p, _mm512_set1_pd(i));
+      }
+      const __mmask8 live = _mm512_cmp_pd_mask(best, zero, _CMP_NEQ_UQ);
+
+      for (int i=k+1; i < n; i++) {
+        const __mmask8 swap = live & _mm512_cmp_pd_mask(p, _mm512_set1_pd(i), _CMP_EQ_OQ);
+        if (swap == 0) continue;
+
+        double *ri = a + (n * i * W);
+        for (int j=0; j < n; j++) {
+          __m512d x = _mm512_loadu_pd(rk + (j * W)), y = _mm512_loadu_pd(ri + (j * W));
+          _mm512_storeu_pd(rk + (j * W), _mm512_mask_blend_pd(swap, x, y));
+          _mm512_storeu_pd(ri + (j * W), _mm512_mask_blend_pd(swap, y, x));
+        }
+        sign = _mm512_mask_sub_pd(sign, swap, zero, sign);
+      }
+
+      const __m512d pivot = _mm512_loadu_pd(rk + (k * W));
+      for (int i=k+1; i < n; i++) {
+        double *ri = a + (n * i * W);
+        const __m512d x = _mm512_loadu_pd(ri + (k * W));
+        const __m512d l = _mm512_div_pd(x, pivot);
+        _mm512_storeu_pd(ri + (k * W), _mm512_mask_blend_pd(live, x, l));
+
+        const __mmask8 update = live & _mm512_cmp_pd_mask(l, zero, _CMP_NEQ_UQ);
+        if (update == 0) continue;
+        for (int j=k+1; j < n; j++) {
+          __m512d y = _mm512_loadu_pd(ri + (j * W));
+          _mm512_storeu_pd(ri + (j * W), _mm512_mask_sub_pd(y, update, y, _mm512_mul_pd(l, _mm512_loadu_pd(rk + (j * W)))));
+        }
+      }
+    }
+
+    __m512d d = sign;
+    for (int k=0; k < n; k++) d = _mm512_mul_pd(d, _mm512_loadu_pd(a + (((n * k) + k) * W)));
+    _mm512_storeu_pd(det, _mm512_mask_blend_pd(_mm512_cmp_pd_mask(d, zero, _CMP_EQ_OQ), d, zero));
+  }
+
+  // the casts pick the right overload of each kernel
+  const kernel_table avx2_table = {
+    deter::avx2,
+    static_cast<void (*)(const int, const double, const double*, double*)>(&eliminate_avx2),
+    static_cast<void (*)(const int, const float, const float*, float*)>(&eliminate_avx2),
+    static_cast<void (*)(const int, const double*, const double*, const double*, const double*, const double*, double*)>(&eliminate4_avx2),
+    static_cast<void (*)(const int, const float*, const float*, const float*, const float*, const float*, float*)>(&eliminate4_avx2),
+    4,
+    &determinant_lanes_avx2
+  };
+
+  const kernel_table avx512_table = {
+    deter::avx512,
+    static_cast<void (*)(const int, const double, const double*, double*)>(&eliminate_avx512),
+    static_cast<void (*)(const int, const float, const float*, float*)>(&eliminate_avx512),
+    static_cast<void (*)(const int, const double*, const double*, const double*, const double*, const double*, double*)>(&eliminate4_avx512),
+    static_cast<void (*)(const int, const float*, const float*, const float*, const float*, const float*, float*)>(&eliminate4_avx512),
+    8,
+    &determinant_lanes_avx512
+  };
+#endif
+
+  const kernel_table* table_for(deter::isa level) {
+#ifdef DETER_X86
+    if (level == deter::avx512) return &avx512_table;
+    if (level == deter::avx2) return &avx2_table;
+#endif
+    return &scalar_table;
+  }
+
+  std::atomic<const kernel_table*> current { table_for(deter::detectIsa()) };
+}
+
+deter::isa deter::detectIsa() {
+#ifdef DETER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return avx2;
+#endif
+  return scalar;
+}
+
+deter::isa deter::kernelIsa() {
+  return current.load()->level;
+}
+
+deter::isa deter::useIsa(isa level) {
+  isa best = detectIsa();
+  if (level > best) level = best;
+
+  current.store(table_for(level));
+  return level;
+}
+
+const char* deter::isaName(isa level) {
+  switch (level) {
+    case avx512: return "avx512";
+    case avx2: return "avx2";
+    default: return "scalar";
+  }
+}
+
+void deter::eliminate(const int n, const double l, const double *x, double *y) {
+  current.load(std::memory_order_relaxed)->eliminate_d(n, l, x, y);
+}
+
+void deter::eliminate(const int n, const float l, const float *x, float *y) {
+  current.load(std::memory_order_relaxed)->eliminate_f(n, l, x, y);
+}
+
+void deter::eliminate4(const int n, const double *l, const double *x0, const double *x1,
+    const double *x2, const double *x3, double *y) {
+  current.load(std::memory_order_relaxed)->eliminate4_d(n, l, x0, x1, x2, x3, y);
+}
+
+void deter::eliminate4(const int n, const float *l, const float *x0, const float *x1,
+    const float *x2, const float *x3, float *y) {
+  current.load(std::memory_order_relaxed)->eliminate4_f(n, l, x0, x1, x2, x3, y);
+}
+
+int deter::laneCount() {
+  return current.load(std::memory_order_relaxed)->lanes;
+}
+
+void deter::determinantLanes(const int n, double *a, double *det) {
+  current.load(std::memory_order_relaxed)->determinant_lanes(n, a, det);
+}
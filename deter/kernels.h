@@ -0,0 +1,132 @@
+/**
+ * Row elimination kernels used by the elimination engines in deter.h. The inner loop
+ * of every elimination is y -= l * x over a row of the matrix, these are vectorized
+ * versions of that loop. The instruction set is picked at runtime from what the CPU
+ * supports so a single binary runs on both older and newer x86 hosts, anything else
+ * (or a CPU without AVX2) uses the scalar loops.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cmath>
+#include <utility>
+
+namespace deter {
+
+  /**
+   * The instruction sets a kernel can be dispatched to, ordered from least to most capable.
+   */
+  enum isa { scalar, avx2, avx512 };
+
+  /**
+   * @return the most capable instruction set supported by this CPU.
+   */
+  isa detectIsa();
+
+  /**
+   * @return the instruction set the kernels currently dispatch to.
+   */
+  isa kernelIsa();
+
+  /**
+   * Force the kernels to dispatch to the given instruction set. A request for something
+   * the CPU does not support is lowered to the best one that it does.
+   *
+   * @param level - the instruction set to use.
+   * @return the instruction set actually selected.
+   */
+  isa useIsa(isa level);
+
+  /**
+   * @return a printable name for the instruction set.
+   */
+  const char* isaName(isa level);
+
+  /**
+   * y[j] -= l * x[j] for j in [0, n)
+   */
+  void eliminate(const int n, const double l, const double *x, double *y);
+  void eliminate(const int n, const float l, const float *x, float *y);
+
+  /**
+   * y[j] -= l[0] * x0[j] + l[1] * x1[j] + l[2] * x2[j] + l[3] * x3[j] for j in [0, n)
+   * Four rows folded into a single pass over y, as used by the blocked trailing update.
+   */
+  void eliminate4(const int n, const double *l, const double *x0, const double *x1,
+      const double *x2, const double *x3, double *y);
+  void eliminate4(const int n, const float *l, const float *x0, const float *x1,
+      const float *x2, const float *x3, float *y);
+
+  /**
+   * @return the number of matrices determinantLanes computes at once, one per vector lane
+   * of the instruction set in use.
+   */
+  int laneCount();
+
+  /**
+   * Computes laneCount() determinants at once. The n x n matrices are interleaved, struct
+   * of arrays: element (i, j) of matrix w is a[(((n * i) + j) * laneCount()) + w]. Each
+   * lane is factored in place with the pivoting of factorLU and without fused multiply
+   * add, so every determinant is exactly that of computeDeterminantLU with -k scalar.
+   *
+   * @param n - the order of the matrices.
+   * @param a - the interleaved matrices, overwritten.
+   * @param det - receives the laneCount() determinants.
+   */
+  void determinantLanes(const int n, double *a, double *det);
+
+  /**
+   * The plain loops, for floating point types without a vectorized kernel.
+   */
+  template<typename F>
+    void eliminate(const int n, const F l, const F *x, F *y) {
+      for (int j=0; j < n; j++) y[j] -= l * x[j];
+    }
+
+  template<typename F>
+    void eliminate4(const int n, const F *l, const F *x0, const F *x1,
+        const F *x2, const F *x3, F *y) {
+      for (int j=0; j < n; j++) y[j] -= (l[0] * x0[j] + l[1] * x1[j]) + (l[2] * x2[j] + l[3] * x3[j]);
+    }
+
+  template<typename F>
+    void determinantLanes(const int lanes, const int n, F *a, F *det) {
+      for (int w=0; w < lanes; w++) {
+        auto at = [=](const int i, const int j) -> F& { return a[(((n * i) + j) * lanes) + w]; };
+
+        int sign = 1;
+        for (int k=0; k < n; k++) {
+          int p = k;
+          F best = std::abs(at(k, k));
+          for (int i=k+1; i < n; i++) {
+            F v = std::abs(at(i, k));
+            if (v > best) { best = v; p = i; }
+          }
+
+          if (best == 0) continue; // nothing to eliminate
+
+          if (p != k) {
+            for (int j=0; j < n; j++) std::swap(at(k, j), at(p, j));
+            sign = -sign;
+          }
+
+          for (int i=k+1; i < n; i++) {
+            F l = at(i, k) / at(k, k);
+            at(i, k) = l;
+            if (l == 0) continue;
+            for (int j=k+1; j < n; j++) at(i, j) -= l * at(k, j);
+          }
+        }
+
+        F d = sign;
+        for (int k=0; k < n; k++) d *= at(k, k);
+        det[w] = (d == 0) ? 0 : d; // no negative zero in the report
+      }
+    }
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * A batch engine for inputs of many small matrices. Consecutive matrices of the same
+ * order are gathered into groups of laneCount(), interleaved into struct of arrays
+ * layout and factored together by determinantLanes, one matrix per vector lane. The
+ * results are reported in input order as each group completes.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef LANES_H
+#define LANES_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "deter.h"
+
+namespace deter {
+
+  /**
+   * The orders computed in lanes, others go to the compute function one at a time.
+   */
+  const int LANES_MIN = 2;
+  const int LANES_MAX = 8;
+
+  /**
+   * read_matrices with the determinants of orders LANES_MIN to LANES_MAX computed in
+   * groups by determinantLanes, exactly as computeDeterminantLU with -k scalar would. The
+   * output is the one read_matrices would produce, the time reported for a matrix is that
+   * of its whole group.
+   *
+   * @param s - the input stream containing the matrix data to read.
+   * @param o - the output stream to write the result data to.
+   * @param compute - the engine for the matrices of the other orders.
+   * @param report - a reporting function that can format the result in a pleasing manner.
+   * @return an overall status, 0 being success and non-zero signaling failure.
+   */
+  template<typename In>
+    int read_matrices_lanes(
+        In &s,
+        std::ostream &o,
+        std::function<double(const Matrix<double>&)> compute,
+        std::function<void(std::ostream &o, const Matrix<double>&, const double, std::chrono::milliseconds)> report) {
+
+      const int lanes = laneCount();
+      std::vector<Matrix<double>> group;
+      int order = 0;
+      std::vector<double> soa, dets(lanes);
+
+      auto now = []() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+      };
+
+      auto flush = [&]() {
+        if (group.empty()) return;
+
+        // the lanes without a matrix stay zero, a singular matrix costs nothing
+        const int count = (int) group.size();
+        soa.assign((size_t) order * order * lanes, 0.0);
+        for (int w=0; w < count; w++) {
+          double *to = soa.data() + w;
+          for (int i=0; i < order; i++) {
+            const double *row = group[w].row(i);
+            for (int j=0; j < order; j++, to += lanes) *to = row[j];
+          }
+        }
+
+        std::chrono::milliseconds start = now();
+        determinantLanes(order, soa.data(), dets.data());
+        std::chrono::milliseconds end = now();
+
+        for (int w=0; w < count; w++) report(o, group[w], dets[w], end - start);
+        group.clear();
+      };
+
+      auto compute_and_report = [&](Matrix<double> &m) {
+        const int size = m.order();
+        if (size < LANES_MIN || size > LANES_MAX) {
+          flush();
+          std::chrono::milliseconds start = now();
+          double det = compute(m);
+          std::chrono::milliseconds end = now();
+          report(o, m, det, end - start);
+          return true;
+        }
+
+        if (size != order) flush();
+        order = size;
+        group.push_back(std::move(m));
+        if ((int) group.size() == lanes) flush();
+        return true;
+      };
+
+      // everything read before an error is reported before it
+      auto report_error = [&](const std::string &msg, const char &badc) {
+        flush();
+        reportError(o, msg, badc);
+      };
+
+      int result = parse_matrices<double>(s, compute_and_report, report_error);
+      flush();
+      return result;
+    }
+
+}
+
+#endif
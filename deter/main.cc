@@ -1,16 +1,58 @@
 #include <iostream>
 #include <fstream>
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
 
 #include "deter.h"
+#include "tiled.h"
+#include "batch.h"
+#include "exact.h"
+#include "decimal.h"
+#include "mapped.h"
+#include "chunked.h"
+#include "binary.h"
+#include "aio.h"
+#include "lanes.h"
+#include "structure.h"
+#include "sparse.h"
+#include "btf.h"
+#include "filter.h"
+#include "factor.h"
+#include "cache.h"
 
 /**
  * usage provides the user with a user friendly description of how to use the application.
  * @param name - the name of the executable.
  */
 void usage(const char* name) {
-  std::cout << "\n\nUsage: " << name << " -f <filename> [ -o <filename> ]\n\n";
-  std::cout << "This program requires a single argument which is the name of the file containing the matrices to compute. An optional second argument [-o] can be supplied to output to a named file.\n\nThe data file should be formatted with nothing but numerical values formated such as:";
+  std::cout << "\n\nUsage: " << name << " -f <filename> [ -o <filename> ] [ -e <engine> ]\n\n";
+  std::cout << "This program requires a single argument which is the name of the file containing the matrices to compute. An optional second argument [-o] can be supplied to output to a named file.\n\n";
+  std::cout << "The determinant engine can be chosen with [-e]:\n";
+  std::cout << "  cofactor - exact Laplace (cofactor) expansion, O(n!), the default and the reference\n";
+  std::cout << "  lu       - LU decomposition with partial pivoting, O(n^3)\n";
+  std::cout << "  simd     - LU decomposition of consecutive matrices of the same order up to 8 in groups, one matrix per vector lane\n";
+  std::cout << "  blocked  - cache blocked LU decomposition, O(n^3), for orders in the hundreds and up\n";
+  std::cout << "  sparse   - sparse LU after a minimum degree ordering, for large matrices that are mostly zeros\n";
+  std::cout << "  tiled    - multi-threaded tiled LU decomposition, O(n^3), for single very large matrices\n";
+  std::cout << "  dp       - exact expansion by dynamic programming over column subsets, O(n*2^n), orders up to 25\n";
+  std::cout << "  bareiss  - exact fraction free elimination for integer matrices, O(n^3), up to 128 bit results\n";
+  std::cout << "  modular  - exact multi-modular elimination for integer matrices, O(n^3) per prime, results of any size\n\n";
+  std::cout << "The number of threads used by the parallel engines is set with [-t], by default one per core and at most " << deter::MAX_THREADS << ".\n\n";
+  std::cout << "For files with many matrices [-b] turns on batch mode: [-t] threads compute matrices concurrently while the results are still reported in input order.\n\n";
+  std::cout << "Decimal values such as -40.59 have no exact floating point form. [-d] reads them exactly as scaled integers and computes the exact determinant, in full, with the integer engines ([-e] is ignored).\n\n";
+  std::cout << "For very large files [-m] maps the file into memory and parses it in place, much faster than the stream reader and with the same validation. [-p] does the same and also parses ranges of the file on [-t] threads in parallel.\n\n";
+  std::cout << "[-c] <filename> converts the data file to the binary container format instead, binary files given to [-f] are recognised and read in place without parsing.\n\n";
+  std::cout << "[-s] reports only the order and the determinant of each matrix, without echoing the matrix.\n\n";
+  std::cout << "Matrices of order " << deter::SPARSE_MIN_ORDER << " and up with fewer than " << deter::SPARSE_DENSITY * 100 << "% non-zeros go to the sparse engine whichever floating point engine [-e] names (lu, simd, blocked, tiled), [-z] <density> sets that fraction (0 turns it off).\n\n";
+  std::cout << "[-r] splits reducible matrices first: the rows and columns are permuted to block triangular form and the irreducible diagonal blocks are computed on [-t] threads, the determinant being their product. It applies to lu, simd, blocked, tiled and sparse, the exact engines take every matrix whole.\n\n";
+  std::cout << "[-g] reports only the sign of each determinant (-1, 0 or 1), certified: LU in floating point with a rigorous bound on its error settles most matrices, the others go to exact arithmetic ([-e] is ignored). The path taken is shown after the sign.\n\n";
+  std::cout << "[-l] factors every matrix once by LU and reports log|det(M)| along with det(M), which overflows at large orders where the log does not. A line \"rhs k\" after a matrix of order n, followed by n rows of k values, is solved from the same factors and the solutions reported, a line \"update row i\" or \"update column j\" followed by the n new values replaces a row or column and reports the new determinant in O(n^2). [-i] reports the inverse of every matrix as well. [-e] is ignored.\n\n";
+  std::cout << "[-x] looks for structure in every matrix first: triangular and diagonal matrices are the product of their diagonal, permutation-like matrices the sign of their permutation, banded matrices get an LU of their band. The path taken is shown after the determinant. With cofactor, dp and bareiss banded matrices go to the engine, the band LU would round; modular ignores [-x].\n\n";
+  std::cout << "[-a] <filename> keeps the determinant of every matrix in a cache on disk under a hash of its values, so a matrix seen before, in this file or an earlier run, is not computed again (\"-\" keeps the cache in memory for this run only). The hits and misses are shown at the end. It caches every engine but modular, with [-x], [-r] and [-b] as well, and cannot be used with -e modular, [-d], [-g] or [-l].\n\n";
+  std::cout << "[-u] reads the data file and writes the output file asynchronously through a ring of buffers (io_uring where the kernel offers it), so the disk works while the matrices are computed.\n\n";
+  std::cout << "The elimination engines use the best vector instructions the CPU supports. [-k] limits them to one of scalar, avx2 or avx512.\n\n";
+  std::cout << "The data file should be formatted with nothing but numerical values formated such as:";
   
   std::cout << R"(
 
@@ -25,6 +67,116 @@ void usage(const char* name) {
 
 }
 
+/**
+ * engine maps an engine name given on the command line to the function computing it.
+ *
+ * @param name - the name of the engine.
+ * @param threads - the number of threads for the parallel engines, 0 for one per core.
+ * @return the compute function, or an empty function if the name is not known.
+ */
+std::function<double(const deter::Matrix<double>&)> engine(const char* name, unsigned threads) {
+  if (strcmp(name, "cofactor") == 0) return &deter::computeDeterminant<double>;
+  if (strcmp(name, "lu") == 0) return &deter::computeDeterminantLU<double>;
+  if (strcmp(name, "simd") == 0) return &deter::computeDeterminantLU<double>; // the orders without lanes
+  if (strcmp(name, "blocked") == 0) return &deter::computeDeterminantBlocked<double>;
+  if (strcmp(name, "sparse") == 0) return &deter::computeDeterminantSparse<double>;
+  if (strcmp(name, "bareiss") == 0) return &deter::computeDeterminantBareiss<double>;
+
+  if (strcmp(name, "tiled") == 0) {
+    auto pool = std::make_shared<deter::ThreadPool>(threads);
+    return [pool](const deter::Matrix<double> &m) {
+      return deter::computeDeterminantTiled<double>(m, *pool);
+    };
+  }
+
+  if (strcmp(name, "dp") == 0) {
+    auto pool = std::make_shared<deter::ThreadPool>(threads);
+    return [pool](const deter::Matrix<double> &m) {
+      return deter::determinantBySubsets<double>(m, pool.get());
+    };
+  }
+
+  return nullptr;
+}
+
+/**
+ * isFloating tells the floating point engines from the exact ones, whose results must not
+ * be replaced by those of another engine.
+ *
+ * @param name - the name of the engine.
+ * @return true for lu, simd, blocked, tiled and sparse.
+ */
+bool isFloating(const char* name) {
+  return strcmp(name, "lu") == 0 || strcmp(name, "simd") == 0 || strcmp(name, "blocked") == 0
+    || strcmp(name, "tiled") == 0 || strcmp(name, "sparse") == 0;
+}
+
+/**
+ * exactEngine maps the name of an engine with an arbitrary precision result to the
+ * function computing it.
+ *
+ * @param name - the name of the engine.
+ * @param threads - the number of threads for the parallel engines, 0 for one per core.
+ * @return the compute function, or an empty function if the name is not known.
+ */
+std::function<deter::BigInt(const deter::Matrix<double>&)> exactEngine(const char* name, unsigned threads) {
+  if (strcmp(name, "modular") == 0) {
+    auto pool = std::make_shared<deter::ThreadPool>(threads);
+    return [pool](const deter::Matrix<double> &m) {
+      return deter::determinantByPrimes<double>(m, pool.get());
+    };
+  }
+
+  return nullptr;
+}
+
+/**
+ * reporter picks the report of every matrix: the matrix echoed with its determinant, or
+ * with [-s] the determinant alone.
+ *
+ * @param summary - true for the determinants alone.
+ * @return the report function.
+ */
+template<typename T, typename R>
+void (*reporter(bool summary))(std::ostream&, const deter::Matrix<T>&, const R, std::chrono::milliseconds) {
+  return summary ? &deter::reportSummary<T, R> : &deter::reportResult<T, R>;
+}
+
+/**
+ * readSerial runs read_matrices over any text input, and read_binary_matrices over a
+ * binary container so its payloads reach the engines without a copy.
+ */
+template<typename T, typename R, typename In, typename Compute, typename Report>
+int readSerial(In &in, std::ostream &outs, Compute compute, Report report) {
+  return deter::read_matrices<T, R>(in, outs, compute, report);
+}
+
+template<typename T, typename R, typename Compute, typename Report>
+int readSerial(deter::BinaryInput &in, std::ostream &outs, Compute compute, Report report) {
+  return deter::read_binary_matrices<T, R>(in, outs, compute, report);
+}
+
+/**
+ * convert writes the matrices of a text file to a binary container.
+ *
+ * @return 0 on success, 1 if the text is not valid or the output cannot be written.
+ */
+int convert(std::istream &in, const char* out_fname) {
+  std::ofstream out(out_fname, std::ofstream::trunc | std::ofstream::binary);
+  if (!out.is_open()) {
+    std::cout << "The file [ " << out_fname << " ] could not be opened for writing." << std::endl;
+    return 1;
+  }
+
+  deter::BinaryWriter writer(out);
+  int result = deter::parse_matrices<double>(in,
+      [&writer](deter::Matrix<double> &m) { writer.add(m); return true; },
+      [](const std::string &msg, const char &badc) { deter::reportError(std::cout, msg, badc); });
+  writer.finish();
+
+  return (result == 0 && out.good()) ? 0 : 1;
+}
+
 /**
  * main entrypoint for the application. Handles the commandline argument parsing and the launching of
  * the application. In particular it manages the opening and closing of files.
@@ -39,6 +191,22 @@ int main(int argc, char** argv) {
   const char* fname;
   const char* out_fname = nullptr;
   bool isInt = true;
+  const char* engine_name = "cofactor";
+  unsigned threads = 0;
+  bool batch = false;
+  bool decimal = false;
+  bool mapped = false;
+  bool parallel = false;
+  bool async = false;
+  bool summary = false;
+  bool structure = false;
+  bool sign_only = false;
+  bool factored = false;
+  bool inverse = false;
+  double sparse_density = deter::SPARSE_DENSITY;
+  bool reducible = false;
+  const char* convert_fname = nullptr;
+  const char* cache_fname = nullptr;
 
   for (int i=1; i < argc; i++) {
     if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-f", 2) == 0) {
@@ -67,12 +235,201 @@ int main(int argc, char** argv) {
       continue;
     }
 
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-e", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-e] requires a parameter <engine>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      engine_name = argv[i];
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-t", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-t] requires a parameter <threads>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      char *end = nullptr;
+      errno = 0;
+      const long count = strtol(argv[i], &end, 10);
+      if (end == argv[i] || *end != '\0' || errno == ERANGE || count <= 0) {
+        std::cout << "Error: The argument [-t] requires a positive number of threads but found [" << argv[i] << "]" << std::endl;
+        usage(argv[0]);
+        return 1;
+      }
+      threads = (unsigned) std::min(count, (long) deter::MAX_THREADS);
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-b", 2) == 0) {
+      batch = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-c", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-c] requires a parameter <filename>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      convert_fname = argv[i];
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-p", 2) == 0) {
+      mapped = true;
+      parallel = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-m", 2) == 0) {
+      mapped = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-s", 2) == 0) {
+      summary = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-z", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-z] requires a parameter <density>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      char *end = nullptr;
+      const double density = strtod(argv[i], &end);
+      if (end == argv[i] || *end != '\0' || !(density >= 0 && density <= 1)) {
+        std::cout << "Error: The argument [-z] requires a density between 0 and 1 but found [" << argv[i] << "]" << std::endl;
+        usage(argv[0]);
+        return 1;
+      }
+      sparse_density = density;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-r", 2) == 0) {
+      reducible = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-a", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-a] requires a parameter <filename>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      cache_fname = argv[i];
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-x", 2) == 0) {
+      structure = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-g", 2) == 0) {
+      sign_only = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-l", 2) == 0) {
+      factored = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-i", 2) == 0) {
+      inverse = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-u", 2) == 0) {
+      async = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-d", 2) == 0) {
+      decimal = true;
+      continue;
+    }
+
+    if ((strlen(argv[i]) == 2) && strncmp(argv[i], "-k", 2) == 0) {
+      if (i+1 >= argc) {
+        std::cout << "Error: The argument [-k] requires a parameter <isa>" << std::endl;
+        return 1;
+      }
+      i = i + 1;
+      if (strcmp(argv[i], "scalar") == 0) deter::useIsa(deter::scalar);
+      else if (strcmp(argv[i], "avx2") == 0) deter::useIsa(deter::avx2);
+      else if (strcmp(argv[i], "avx512") == 0) deter::useIsa(deter::avx512);
+      else {
+        std::cout << "Error: Unknown instruction set [" << argv[i] << "]" << std::endl;
+        return 1;
+      }
+      continue;
+    }
+
     std::cout << "Error: Unknown argument [" << argv[i] << "]" << std::endl;
     usage(argv[0]);
     return 1;
 
   }
 
+  auto compute = engine(engine_name, threads);
+  auto compute_exact = exactEngine(engine_name, threads);
+  if (!compute && !compute_exact) {
+    std::cout << "Error: Unknown engine [" << engine_name << "]" << std::endl;
+    usage(argv[0]);
+    return 1;
+  }
+
+  // large mostly zero matrices go to the sparse engine, whichever floating point engine
+  // was chosen
+  if (compute && isFloating(engine_name) && sparse_density > 0) {
+    compute = [dense = compute, sparse_density](const deter::Matrix<double> &m) {
+      return deter::isSparse(m, sparse_density) ? deter::computeDeterminantSparse(m) : dense(m);
+    };
+  }
+
+  // and a reducible matrix is taken apart into its irreducible blocks before all that, the
+  // product of the blocks would not be exact
+  if (compute && isFloating(engine_name) && reducible) {
+    auto pool = std::make_shared<deter::ThreadPool>(threads);
+    compute = [whole = compute, pool](const deter::Matrix<double> &m) {
+      return deter::computeDeterminantBTF(m, whole, pool.get());
+    };
+  }
+
+  // and a matrix seen before is not computed at all, the results of different engines
+  // and options being kept apart
+  if (cache_fname != nullptr && (!compute || decimal || sign_only || factored)) {
+    std::cout << "Error: The argument [-a] caches the determinants of the double engines, it cannot be used with -e modular, -d, -g or -l" << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<deter::ResultCache<double>> cache;
+  if (cache_fname != nullptr) {
+    const std::string name = std::string(engine_name) + " z=" + std::to_string(sparse_density) + (reducible ? " r" : "")
+      + " " + deter::isaName(deter::kernelIsa());
+    try {
+      cache = std::make_shared<deter::ResultCache<double>>(name, strcmp(cache_fname, "-") == 0 ? nullptr : cache_fname);
+    } catch (const std::exception &e) {
+      std::cout << "The cache [ " << cache_fname << " ] could not be opened: " << e.what() << std::endl;
+      return 1;
+    }
+    compute = [inner = compute, cache](const deter::Matrix<double> &m) {
+      return cache->get(m, inner);
+    };
+  }
+
+  // hits and misses once the matrices are done
+  auto cacheSummary = [&cache]() {
+    if (cache) std::cout << "Cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
+  };
+
   // is this a readable file?
   std::ifstream data(fname);
 
@@ -81,19 +438,182 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  if (convert_fname != nullptr) return convert(data, convert_fname);
+
+  // binary containers are recognised by their magic and always mapped
+  char magic[8] = {};
+  data.read(magic, sizeof(magic));
+  const bool binary = deter::isBinary(magic, magic + data.gcount());
+  data.clear();
+  data.seekg(0);
+  if (binary) mapped = true;
+
+  // run the matrices through the selected pipeline, an engine that cannot handle a
+  // matrix stops processing just like invalid input does
+  auto process = [&](auto &in, std::ostream &outs) {
+    try {
+      if (decimal) {
+        if constexpr (std::is_same<std::decay_t<decltype(in)>, deter::BinaryInput>::value) {
+          throw std::invalid_argument("Decimal mode reads text files only");
+        } else {
+          auto pool = std::make_shared<deter::ThreadPool>(threads);
+          std::function<deter::Decimal(const deter::Matrix<deter::Fixed>&)> compute_decimal =
+            [pool](const deter::Matrix<deter::Fixed> &m) {
+              return deter::scaledDeterminant(m, pool.get());
+            };
+
+          if (batch) {
+            return deter::read_matrices_batch<deter::Fixed, deter::Decimal>(in, outs, compute_decimal, reporter<deter::Fixed, deter::Decimal>(summary), threads);
+          }
+
+          return deter::read_matrices<deter::Fixed, deter::Decimal>(in, outs, compute_decimal, reporter<deter::Fixed, deter::Decimal>(summary));
+        }
+      }
+
+      if (factored) {
+        using Input = std::decay_t<decltype(in)>;
+        if constexpr (std::is_same<Input, deter::BinaryInput>::value || std::is_same<Input, deter::ChunkedInput>::value) {
+          throw std::invalid_argument("Factored mode reads text serially only");
+        } else {
+          return deter::read_factored<double>(in, outs, inverse, reporter<double, deter::factored<double>>(summary));
+        }
+      }
+
+      if (sign_only) {
+        auto pool = std::make_shared<deter::ThreadPool>(threads);
+        std::function<deter::certified_sign(const deter::Matrix<double>&)> compute_sign = [pool](const deter::Matrix<double> &m) {
+          return deter::certifySign(m, pool.get());
+        };
+
+        if (batch) {
+          return deter::read_matrices_batch<double, deter::certified_sign>(in, outs, compute_sign, reporter<double, deter::certified_sign>(summary), threads);
+        }
+
+        return readSerial<double, deter::certified_sign>(in, outs, compute_sign, reporter<double, deter::certified_sign>(summary));
+      }
+
+      if (compute_exact) {
+        if (batch) {
+          return deter::read_matrices_batch<double, deter::BigInt>(in, outs, compute_exact, reporter<double, deter::BigInt>(summary), threads);
+        }
+
+        return readSerial<double, deter::BigInt>(in, outs, compute_exact, reporter<double, deter::BigInt>(summary));
+      }
+
+      if (structure) {
+        // the simd engine has no lanes here, its matrices go one at a time to lu, and the
+        // exact engines keep the banded matrices, which the band LU would round
+        using Result = deter::structured<double>;
+        const bool exact = !isFloating(engine_name);
+        std::function<Result(const deter::Matrix<double>&)> compute_structured = [&compute, exact](const deter::Matrix<double> &m) {
+          return deter::computeDeterminantStructured(m, compute, exact);
+        };
+
+        if (batch) {
+          return deter::read_matrices_batch<double, Result>(in, outs, compute_structured, reporter<double, Result>(summary), threads);
+        }
+
+        return readSerial<double, Result>(in, outs, compute_structured, reporter<double, Result>(summary));
+      }
+
+      // the lanes take matrices in groups, past the cache
+      if (strcmp(engine_name, "simd") == 0 && !cache) {
+        return deter::read_matrices_lanes(in, outs, compute, reporter<double, double>(summary));
+      }
+
+      if (batch) {
+        return deter::read_matrices_batch<double>(in, outs, compute, reporter<double, double>(summary), threads);
+      }
+
+      return readSerial<double, double>(in, outs, compute, reporter<double, double>(summary));
+    } catch (const std::exception &e) {
+      outs << "ERROR -- Processing stopped. " << std::endl;
+      outs << "Error during processing: " << e.what() << std::endl;
+      return 1;
+    }
+  };
+
+  // the mapped input runs the same parser over the file in memory
+  std::unique_ptr<deter::MappedFile> map;
+  if (mapped) {
+    try {
+      map = std::make_unique<deter::MappedFile>(fname);
+    } catch (const std::system_error &e) {
+      std::cout << "The file [ " << fname << " ] could not be opened for reading." << std::endl;
+      return 1;
+    }
+  }
+
+  auto run = [&](std::ostream &outs) {
+    if (binary) {
+      try {
+        deter::BinaryInput in(map->begin(), map->end());
+        return process(in, outs);
+      } catch (const std::exception &e) {
+        outs << "ERROR -- Processing stopped. " << std::endl;
+        outs << "Error during processing: " << e.what() << std::endl;
+        return 1;
+      }
+    }
+
+    if (map && parallel) {
+      deter::ThreadPool parse_pool(threads);
+      deter::ChunkedInput in(map->begin(), map->end(), parse_pool);
+      return process(in, outs);
+    }
+
+    if (map) {
+      deter::BufferInput in(map->begin(), map->end());
+      return process(in, outs);
+    }
+
+    // the asynchronous reader keeps the next chunks of the file in flight while parsing
+    if (async) {
+      deter::AsyncReader buffer(fname);
+      if (buffer.is_open()) {
+        std::istream in(&buffer);
+        return process(in, outs);
+      }
+    }
+
+    return process(data, outs);
+  };
+
   // are we writing to a file?
+  if (out_fname != nullptr && async) {
+    deter::AsyncWriter buffer(out_fname);
+    if (!buffer.is_open()) {
+      std::cout << "The file [ " << out_fname << " ] could not be opened for writing." << std::endl;
+      return 1;
+    }
+
+    std::ostream outs(&buffer);
+    run(outs);
+    cacheSummary();
+
+    // clean up
+    if (!buffer.close()) {
+      std::cout << "The file [ " << out_fname << " ] could not be written." << std::endl;
+      return 1;
+    }
+    data.close();
+
+    return 0;
+  }
+
   if (out_fname != nullptr) {
-    std::ofstream outs(out_fname, std::ofstream::trunc);
+    // the reports are written without flushing, into a large buffer
+    std::vector<char> sink(deter::OUTPUT_BUFFER);
+    std::ofstream outs;
+    outs.rdbuf()->pubsetbuf(sink.data(), sink.size());
+    outs.open(out_fname, std::ofstream::trunc);
     if (!outs.is_open()) {
       std::cout << "The file [ " << out_fname << " ] could not be opened for writing." << std::endl;
       return 1;
     }
 
-    deter::read_matrices<double>(
-        data, 
-        outs,
-        &deter::computeDeterminant<double>, 
-        &deter::reportResult<double>);
+    run(outs);
+    cacheSummary();
 
     // clean up
     outs.close();
@@ -103,11 +623,8 @@ int main(int argc, char** argv) {
   }
     
 
-  deter::read_matrices<double>(
-      data, 
-      std::cout,
-      &deter::computeDeterminant<double>, 
-      &deter::reportResult<double>);
+  run(std::cout);
+  cacheSummary();
 
   data.close();
   return 0;
@@ -0,0 +1,48 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "mapped.h"
+
+/**
+ * Implementation for the MappedFile class.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+deter::MappedFile::MappedFile(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+
+  length = (size_t) st.st_size;
+  if (length > 0) {
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      int err = errno;
+      close(fd);
+      throw std::system_error(err, std::generic_category(), path);
+    }
+
+    // the parser reads front to back exactly once, one call per advice as they are not flags
+    madvise(addr, length, MADV_SEQUENTIAL);
+    madvise(addr, length, MADV_WILLNEED);
+    bytes = (const char*) addr;
+  }
+
+  // the mapping stays valid without the descriptor
+  close(fd);
+}
+
+deter::MappedFile::~MappedFile() {
+  if (bytes != nullptr) munmap((void*) bytes, length);
+}
@@ -0,0 +1,217 @@
+/**
+ * The fast input path. MappedFile maps the data file into memory and BufferInput reads
+ * it with plain pointer arithmetic and std::from_chars, in place of the locale aware
+ * std::istream machinery. BufferInput keeps the state semantics of an std::istream
+ * (peek, get, eof, fail and what operator>> consumes), so parse_matrices runs on it
+ * unchanged and accepts and rejects exactly the same input with the same messages.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef MAPPED_H
+#define MAPPED_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ios>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace deter {
+
+  /**
+   * A read only memory mapping of a whole file.
+   */
+  class MappedFile {
+    const char *bytes = nullptr;
+    size_t length = 0;
+
+    public:
+      /**
+       * @param path - the file to map.
+       * @throw std::system_error if the file cannot be opened or mapped.
+       */
+      explicit MappedFile(const char *path);
+      ~MappedFile();
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      const char* begin() const { return bytes; }
+      const char* end() const { return bytes + length; }
+      size_t size() const { return length; }
+  };
+
+  /**
+   * An input over a range of characters with the semantics of an std::istream in the
+   * "C" locale: peek and get set eof at the end and fail once past it, extraction
+   * skips whitespace, consumes what num_get would and stores what it would.
+   */
+  class BufferInput {
+    const char *p;
+    const char *last;
+    bool at_eof = false;
+    bool failed = false;
+
+    public:
+      BufferInput(const char *first, const char *last) : p(first), last(last) { }
+
+      explicit operator bool() const { return !failed; }
+      bool eof() const { return at_eof; }
+      bool fail() const { return failed; }
+
+      /**
+       * @return the next character to be read.
+       */
+      const char* position() const { return p; }
+
+      void setstate(std::ios::iostate state) {
+        if (state & std::ios::eofbit) at_eof = true;
+        if (state & (std::ios::failbit | std::ios::badbit)) failed = true;
+      }
+
+      int peek() {
+        if (at_eof || failed) { failed = true; return EOF; }
+        if (p == last) { at_eof = true; return EOF; }
+        return (unsigned char) *p;
+      }
+
+      int get() {
+        if (at_eof || failed) { failed = true; return EOF; }
+        if (p == last) { at_eof = failed = true; return EOF; }
+        return (unsigned char) *p++;
+      }
+
+      /**
+       * Reads a value like operator>> of an std::istream. Signed integers and floating
+       * point are parsed here, any other type with readValue(BufferInput&, T&) found
+       * by argument dependent lookup.
+       */
+      template<typename T>
+        BufferInput& operator>>(T &v) {
+          if (!sentry()) return *this;
+
+          if constexpr (std::is_floating_point<T>::value) {
+            read_float(v);
+          } else if constexpr (std::is_integral<T>::value) {
+            static_assert(std::is_signed<T>::value, "Signed integer type is required.");
+            long l = read_long();
+            // as istream::operator>>(int&), narrower types clamp to their range
+            if (l < std::numeric_limits<T>::min()) { failed = true; v = std::numeric_limits<T>::min(); }
+            else if (l > std::numeric_limits<T>::max()) { failed = true; v = std::numeric_limits<T>::max(); }
+            else v = (T) l;
+          } else {
+            readValue(*this, v);
+          }
+
+          return *this;
+        }
+
+    private:
+      static bool space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+      }
+
+      static bool digit(char c) { return c >= '0' && c <= '9'; }
+
+      // istream::sentry: skips whitespace, fails at the end
+      bool sentry() {
+        if (at_eof || failed) { failed = true; return false; }
+        while (p != last && space(*p)) p++;
+        if (p == last) { at_eof = failed = true; return false; }
+        return true;
+      }
+
+      // num_get for long: sign, digits, saturating on overflow
+      long read_long() {
+        bool negative = false;
+        if (*p == '-' || *p == '+') negative = (*p++ == '-');
+
+        const unsigned long max = negative ? (unsigned long) std::numeric_limits<long>::max() + 1 : (unsigned long) std::numeric_limits<long>::max();
+        unsigned long result = 0;
+        bool any = false, overflow = false;
+        for (; p != last && digit(*p); p++) {
+          const unsigned d = *p - '0';
+          any = true;
+          if (result > max / 10 || (result * 10) > max - d) overflow = true;
+          else result = (result * 10) + d;
+        }
+        if (p == last) at_eof = true;
+
+        if (!any) { failed = true; return 0; }
+        if (overflow) { failed = true; return negative ? std::numeric_limits<long>::min() : std::numeric_limits<long>::max(); }
+        return negative ? (long) (0 - result) : (long) result;
+      }
+
+      // num_get for floating point: collects [sign] digits [. digits] [e [sign] digits]
+      // the way libstdc++ does, then converts the whole token or fails
+      template<typename F>
+        void read_float(F &v) {
+          const char *start = p;
+          if (*p == '-' || *p == '+') p++;
+
+          // the significant digits and places after the point, for the fast path below
+          uint64_t digits = 0;
+          int count = 0, places = 0;
+
+          bool mantissa = false, point = false, sci = false;
+          while (p != last) {
+            const char c = *p;
+            if (digit(c)) {
+              mantissa = true;
+              if (!sci) {
+                if (digits != 0 || c != '0') count++;
+                digits = (count <= 19) ? (digits * 10) + (c - '0') : digits;
+                if (point) places++;
+              }
+            } else if (c == '.' && !point && !sci) {
+              point = true;
+            } else if ((c == 'e' || c == 'E') && !sci && mantissa) {
+              sci = true;
+              if (++p == last) break;
+              if (*p != '-' && *p != '+') continue;
+            } else {
+              break;
+            }
+            p++;
+          }
+          if (p == last) at_eof = true;
+
+          // Clinger's fast path: digits and 10^places are both exact doubles, so one
+          // correctly rounded division gives exactly what strtod would
+          if (std::is_same<F, double>::value && mantissa && !sci && count <= 15 && places <= 22) {
+            static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+              1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+            double value = (double) digits / powers[places];
+            v = (F) ((*start == '-') ? -value : value);
+            return;
+          }
+
+          const char *first = (*start == '+') ? start + 1 : start;
+          F value;
+          auto res = std::from_chars(first, p, value);
+          if (res.ec == std::errc::result_out_of_range && res.ptr == p) {
+            // out of range either way, strtod tells overflow from a denormal result
+            std::string token(start, p);
+            if constexpr (std::is_same<F, float>::value) value = strtof(token.c_str(), nullptr);
+            else if constexpr (std::is_same<F, double>::value) value = strtod(token.c_str(), nullptr);
+            else value = strtold(token.c_str(), nullptr);
+          } else if (res.ec != std::errc() || res.ptr != p || first == p) {
+            failed = true;
+            v = 0;
+            return;
+          }
+
+          if (value > std::numeric_limits<F>::max()) { failed = true; value = std::numeric_limits<F>::max(); }
+          if (value < -std::numeric_limits<F>::max()) { failed = true; value = -std::numeric_limits<F>::max(); }
+          v = value;
+        }
+  };
+
+}
+
+#endif
@@ -0,0 +1,262 @@
+/**
+ * The matrix every engine takes. The storage is 64 byte aligned and its rows are a
+ * stride apart that is padded to whole cache lines, and off the multiples of 4 KiB that
+ * would put a whole column in one cache set. A Matrix either owns its storage or is a
+ * view into storage owned elsewhere (a sub-matrix, a mapped file), so a block or a
+ * payload is handed to an engine without a copy.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace deter {
+
+  /**
+   * The alignment of the storage and the unit rows are padded to.
+   */
+  const size_t MATRIX_ALIGN = 64;
+
+  /**
+   * The row stride a Matrix of the given number of columns gets by default. Rows shorter
+   * than a cache line are left dense, small matrices would mostly be padding otherwise.
+   *
+   * @param cols - the number of columns.
+   * @return the stride in elements.
+   */
+  template<typename T>
+    int paddedStride(const int cols) {
+      const size_t line = MATRIX_ALIGN / sizeof(T);
+      if (MATRIX_ALIGN % sizeof(T) != 0 || (size_t) cols * sizeof(T) < MATRIX_ALIGN) return cols;
+
+      size_t stride = ((cols + line - 1) / line) * line;
+      if ((stride * sizeof(T)) % 4096 == 0) stride += line;
+      return (int) stride;
+    }
+
+  /**
+   * The sign of a permutation by its cycles, a cycle of length l being l - 1 swaps.
+   *
+   * @param to - where every index goes, a permutation of 0 .. n - 1.
+   * @return 1 or -1.
+   */
+  inline int permutationSign(const std::vector<int> &to) {
+    const int n = (int) to.size();
+    int sign = 1;
+    std::vector<unsigned char> seen(n, 0);
+    for (int i=0; i < n; i++) {
+      for (int j=to[i]; !seen[i] && j != i; j=to[j]) sign = -sign;
+      for (int j=i; !seen[j]; j=to[j]) seen[j] = 1;
+    }
+    return sign;
+  }
+
+  template<typename T>
+    class ConstView;
+
+  template<typename T>
+    class Matrix {
+      static_assert(std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value,
+          "Trivially copyable type is required.");
+
+      struct release {
+        void operator()(T *p) const { ::operator delete[](p, std::align_val_t(MATRIX_ALIGN)); }
+      };
+
+      std::unique_ptr<T[], release> storage;
+      size_t capacity = 0;
+      T *base = nullptr;
+      int n_rows = 0;
+      int n_cols = 0;
+      int ld = 0;
+
+      public:
+        Matrix() = default;
+
+        /**
+         * A zeroed square matrix.
+         *
+         * @param order - the order of the matrix.
+         * @param stride - the row stride, 0 for paddedStride.
+         */
+        explicit Matrix(const int order, const int stride = 0) { resize(order, order, stride); }
+
+        /**
+         * A zeroed rows x cols matrix.
+         */
+        Matrix(const int rows, const int cols, const int stride) { resize(rows, cols, stride); }
+
+        Matrix(Matrix &&other) noexcept { *this = std::move(other); }
+
+        Matrix& operator=(Matrix &&other) noexcept {
+          storage = std::move(other.storage);
+          capacity = other.capacity;
+          base = other.base;
+          n_rows = other.n_rows;
+          n_cols = other.n_cols;
+          ld = other.ld;
+          other.capacity = 0;
+          other.base = nullptr;
+          other.n_rows = other.n_cols = other.ld = 0;
+          return *this;
+        }
+
+        Matrix(const Matrix&) = delete;
+        Matrix& operator=(const Matrix&) = delete;
+
+        /**
+         * A view of rows x cols values a stride apart owned by someone else, who must keep
+         * them alive while the view is in use.
+         */
+        static Matrix view(T *data, const int rows, const int cols, const int stride) {
+          Matrix m;
+          m.base = data;
+          m.n_rows = rows;
+          m.n_cols = cols;
+          m.ld = stride;
+          return m;
+        }
+
+        /**
+         * A read only view of values owned by someone else, a mapped file for instance.
+         */
+        static ConstView<T> view(const T *data, const int rows, const int cols, const int stride) {
+          return ConstView<T>(view(const_cast<T*>(data), rows, cols, stride));
+        }
+
+        /**
+         * @return a view of the whole matrix, read only for a const matrix.
+         */
+        Matrix view() { return view(base, n_rows, n_cols, ld); }
+        ConstView<T> view() const { return view((const T*) base, n_rows, n_cols, ld); }
+
+        /**
+         * @return a view of the rows x cols block whose top left value is (row, col), read
+         * only for a const matrix.
+         */
+        Matrix block(const int row, const int col, const int rows, const int cols) {
+          return view(base + ((size_t) ld * row) + col, rows, cols, ld);
+        }
+
+        ConstView<T> block(const int row, const int col, const int rows, const int cols) const {
+          return view((const T*) base + ((size_t) ld * row) + col, rows, cols, ld);
+        }
+
+        /**
+         * Makes this a zeroed rows x cols matrix. The storage is reused when it is owned
+         * and large enough, so one Matrix can hold matrix after matrix without allocating.
+         *
+         * @param stride - the row stride, 0 for paddedStride.
+         */
+        void resize(const int rows, const int cols, const int stride = 0) {
+          if (rows < 0 || cols < 0) throw std::invalid_argument("A matrix cannot have a negative size");
+
+          const int s = (stride > 0) ? std::max(stride, cols) : paddedStride<T>(cols);
+          const size_t count = (size_t) rows * s;
+          if (!storage || count > capacity) {
+            storage.reset(count ? (T*) ::operator new[](count * sizeof(T), std::align_val_t(MATRIX_ALIGN)) : nullptr);
+            capacity = count;
+          }
+
+          base = storage.get();
+          n_rows = rows;
+          n_cols = cols;
+          ld = s;
+          std::fill(base, base + count, T());
+        }
+
+        void resize(const int order) { resize(order, order); }
+
+        /**
+         * Makes room for rows rows at the current stride, keeping the values.
+         *
+         * @throw std::invalid_argument for a view, whose storage cannot grow.
+         */
+        void reserveRows(const int rows) {
+          const size_t count = (size_t) rows * ld;
+          if (count <= capacity) return;
+          if (!empty() && !owner()) throw std::invalid_argument("A view cannot be resized");
+
+          T *bigger = (T*) ::operator new[](count * sizeof(T), std::align_val_t(MATRIX_ALIGN));
+          std::copy(base, base + ((size_t) n_rows * ld), bigger);
+          storage.reset(bigger);
+          capacity = count;
+          base = bigger;
+        }
+
+        /**
+         * Sets the number of rows, keeping the values of the rows there were and zeroing
+         * the new ones. The storage grows by half again when it has to, so a matrix read
+         * row by row is copied O(log n) times and is only as large as what was read.
+         */
+        void resizeRows(const int rows) {
+          if (rows < 0) throw std::invalid_argument("A matrix cannot have a negative size");
+          if ((size_t) rows * ld > capacity) reserveRows(std::max(rows, (int) ((capacity + (capacity / 2)) / ld)));
+
+          if (rows > n_rows) std::fill(row(n_rows), row(rows), T());
+          n_rows = rows;
+        }
+
+        /**
+         * Copies the values of another matrix of the same shape, converting them to T.
+         */
+        template<typename U>
+          void assign(const Matrix<U> &other) {
+            for (int i=0; i < n_rows; i++) std::copy(other.row(i), other.row(i) + n_cols, row(i));
+          }
+
+        int order() const { return n_rows; }
+        int rows() const { return n_rows; }
+        int cols() const { return n_cols; }
+        int stride() const { return ld; }
+        bool empty() const { return base == nullptr; }
+
+        /**
+         * @return true if the matrix owns its storage, false for a view.
+         */
+        bool owner() const { return storage != nullptr; }
+
+        T* data() { return base; }
+        const T* data() const { return base; }
+
+        T* row(const int i) { return base + ((size_t) ld * i); }
+        const T* row(const int i) const { return base + ((size_t) ld * i); }
+
+        T& operator()(const int i, const int j) { return base[((size_t) ld * i) + j]; }
+        const T& operator()(const int i, const int j) const { return base[((size_t) ld * i) + j]; }
+    };
+
+  /**
+   * A view that only hands out its Matrix as const, so values that must not be written
+   * (a const Matrix, a read only mapping) are not. It converts to const Matrix<T>& and
+   * goes wherever the engines take one.
+   */
+  template<typename T>
+    class ConstView {
+      Matrix<T> m;
+
+      explicit ConstView(Matrix<T> &&view) : m(std::move(view)) { }
+      friend class Matrix<T>;
+
+      public:
+        ConstView() = default;
+
+        const Matrix<T>& get() const { return m; }
+        operator const Matrix<T>&() const { return m; }
+        const Matrix<T>* operator->() const { return &m; }
+        const T& operator()(const int i, const int j) const { return m(i, j); }
+    };
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "pool.h"
+
+/**
+ * Implementation for the ThreadPool class.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+namespace {
+  // which pool (if any) the current thread works for, and its deque
+  thread_local const deter::ThreadPool* current_pool = nullptr;
+  thread_local int current_index = -1;
+}
+
+deter::ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, MAX_THREADS);
+
+  for (unsigned i=0; i < threads; i++) queues.push_back(std::make_unique<task_queue>());
+  for (unsigned i=0; i < threads; i++) workers.emplace_back(&ThreadPool::work, this, (int) i);
+}
+
+deter::ThreadPool::~ThreadPool() {
+  wait();
+
+  {
+    std::lock_guard<std::mutex> guard(sleep_lock);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (auto &t : workers) t.join();
+}
+
+int deter::ThreadPool::worker_index() const {
+  return (current_pool == this) ? current_index : -1;
+}
+
+void deter::ThreadPool::submit(std::function<void()> task) {
+  int q = worker_index();
+  if (q < 0) q = (int) (next++ % queues.size());
+
+  pending++;
+  {
+    std::lock_guard<std::mutex> guard(queues[q]->lock);
+    queues[q]->tasks.push_back(std::move(task));
+    queued++;
+  }
+
+  // take the sleep lock so a thread about to sleep cannot miss the new task
+  { std::lock_guard<std::mutex> guard(sleep_lock); }
+  wake.notify_one();
+  if (waiters > 0) idle.notify_all();
+}
+
+bool deter::ThreadPool::run_one(int self) {
+  std::function<void()> task;
+
+  // own deque first, newest task
+  if (self >= 0) {
+    std::lock_guard<std::mutex> guard(queues[self]->lock);
+    if (!queues[self]->tasks.empty()) {
+      task = std::move(queues[self]->tasks.back());
+      queues[self]->tasks.pop_back();
+      queued--;
+    }
+  }
+
+  // then steal the oldest task of someone else
+  const int n = (int) queues.size();
+  for (int i=1; !task && i <= n; i++) {
+    int victim = (self + i + n) % n;
+    std::lock_guard<std::mutex> guard(queues[victim]->lock);
+    if (!queues[victim]->tasks.empty()) {
+      task = std::move(queues[victim]->tasks.front());
+      queues[victim]->tasks.pop_front();
+      queued--;
+    }
+  }
+
+  if (!task) return false;
+
+  task();
+
+  pending--;
+  if (waiters > 0) {
+    { std::lock_guard<std::mutex> guard(sleep_lock); }
+    idle.notify_all();
+  }
+
+  return true;
+}
+
+void deter::ThreadPool::work(int self) {
+  current_pool = this;
+  current_index = self;
+
+  while (true) {
+    if (run_one(self)) continue;
+
+    std::unique_lock<std::mutex> lock(sleep_lock);
+    wake.wait(lock, [this]() { return stopping || queued > 0; });
+    if (stopping && queued == 0) return;
+  }
+}
@@ -0,0 +1,128 @@
+/**
+ * ThreadPool is a small work stealing pool shared by the parallel engines. Every worker
+ * owns a deque of tasks, it pushes and pops at the back of its own deque (so the task it
+ * just made ready runs next, while its data is still in cache) and steals from the front
+ * of the others when it runs dry. Tasks submitted from outside the pool are spread over
+ * the workers round robin.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace deter {
+
+  /**
+   * The most workers a pool or batch run gets, a larger count is capped to it.
+   */
+  const unsigned MAX_THREADS = 1024;
+
+  class ThreadPool {
+    public:
+      /**
+       * Start a pool of the given number of workers, 0 meaning one per hardware thread, at
+       * most MAX_THREADS.
+       */
+      explicit ThreadPool(unsigned threads = 0);
+
+      /**
+       * Finishes the queued work and joins the workers.
+       */
+      ~ThreadPool();
+
+      ThreadPool(const ThreadPool&) = delete;
+      ThreadPool& operator=(const ThreadPool&) = delete;
+
+      /**
+       * Queue a task. Tasks may submit further tasks, wait() covers those as well.
+       */
+      void submit(std::function<void()> task);
+
+      /**
+       * Block until every submitted task has run. Only for use from outside the pool,
+       * a task waiting on its own work should use wait_until.
+       */
+      void wait() { wait_until([this]() { return pending == 0; }); }
+
+      /**
+       * Block until done() holds. The calling thread runs queued tasks while it waits,
+       * so a task can wait on work it submitted without tying up a worker.
+       */
+      template<typename Done>
+        void wait_until(Done done) {
+          int self = worker_index();
+
+          while (!done()) {
+            if (run_one(self)) continue;
+
+            std::unique_lock<std::mutex> lock(sleep_lock);
+            waiters++;
+            idle.wait(lock, [&]() { return done() || queued > 0; });
+            waiters--;
+          }
+        }
+
+      /**
+       * @return the number of workers.
+       */
+      unsigned size() const { return (unsigned) workers.size(); }
+
+      /**
+       * Run fn(i) for every i in [begin, end), split into roughly even chunks over the
+       * workers, and wait for all of them. Safe to call from inside a task.
+       */
+      template<typename Fn>
+        void parallel_for(const long begin, const long end, Fn fn) {
+          if (end <= begin) return;
+
+          const long chunks = std::min<long>(end - begin, 4 * (long) size());
+          const long step = (end - begin + chunks - 1) / chunks;
+          std::atomic<long> left { (end - begin + step - 1) / step };
+          for (long c=begin; c < end; c += step) {
+            const long last = std::min(c + step, end);
+            submit([c, last, &fn, &left]() {
+                for (long i=c; i < last; i++) fn(i);
+                left--;
+            });
+          }
+
+          wait_until([&left]() { return left == 0; });
+        }
+
+    private:
+      struct task_queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+      };
+
+      int worker_index() const;
+      bool run_one(int self);
+      void work(int self);
+
+      std::vector<std::unique_ptr<task_queue>> queues;
+      std::vector<std::thread> workers;
+      std::atomic<unsigned> next { 0 };
+      std::atomic<long> queued { 0 };  // tasks sitting in a deque
+      std::atomic<long> pending { 0 }; // tasks submitted but not yet finished
+      std::atomic<long> waiters { 0 }; // threads blocked in wait_until
+
+      std::mutex sleep_lock;
+      std::condition_variable wake;    // workers out of work
+      std::condition_variable idle;    // threads in wait_until
+      bool stopping = false;
+  };
+
+}
+
+#endif
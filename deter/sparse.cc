@@ -0,0 +1,104 @@
+#include <set>
+#include <utility>
+
+#include "sparse.h"
+
+/**
+ * Implementation for the minimum degree ordering of the sparse engine.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+std::vector<int> deter::minimumDegreeOrder(const sparse_pattern &rows, const sparse_pattern &cols) {
+  const int n = rows.n;
+
+  // variables adjacent to each node in A + A^T, and the elements adjacent to it
+  std::vector<std::vector<int>> vars(n), elems(n), members(n);
+  for (int i=0; i < n; i++) {
+    std::vector<int> &adj = vars[i];
+    for (int k=rows.start[i]; k < rows.start[i + 1]; k++) {
+      if (rows.index[k] != i) adj.push_back(rows.index[k]);
+    }
+    for (int k=cols.start[i]; k < cols.start[i + 1]; k++) {
+      if (cols.index[k] != i) adj.push_back(cols.index[k]);
+    }
+    std::sort(adj.begin(), adj.end());
+    adj.erase(std::unique(adj.begin(), adj.end()), adj.end());
+  }
+
+  std::vector<int> degree(n);
+  std::set<std::pair<int, int>> queue;
+  for (int i=0; i < n; i++) {
+    degree[i] = (int) vars[i].size();
+    queue.insert({ degree[i], i });
+  }
+
+  std::vector<unsigned char> eliminated(n, 0), absorbed(n, 0);
+  std::vector<int> mark(n, -1), outside(n, -1);
+  std::vector<int> order;
+  order.reserve(n);
+
+  for (int k=0; k < n; k++) {
+    const int p = queue.begin()->second;
+    queue.erase(queue.begin());
+    eliminated[p] = 1;
+    order.push_back(p);
+
+    // the new element: every variable p is adjacent to, directly or through its elements,
+    // which are all contained in it from now on
+    std::vector<int> lp;
+    mark[p] = k;
+    for (int v : vars[p]) {
+      if (!eliminated[v] && mark[v] != k) { mark[v] = k; lp.push_back(v); }
+    }
+    for (int e : elems[p]) {
+      if (absorbed[e]) continue;
+      for (int v : members[e]) {
+        if (!eliminated[v] && mark[v] != k) { mark[v] = k; lp.push_back(v); }
+      }
+      absorbed[e] = 1;
+      std::vector<int>().swap(members[e]);
+    }
+    std::vector<int>().swap(vars[p]);
+    std::vector<int>().swap(elems[p]);
+
+    // |Le \ Lp| for the other elements next to Lp, by counting down from |Le|
+    for (int i : lp) {
+      for (int e : elems[i]) {
+        if (absorbed[e]) continue;
+        if (outside[e] < 0) outside[e] = (int) members[e].size();
+        outside[e]--;
+      }
+    }
+
+    for (int i : lp) {
+      // the variables in Lp are reached through p now
+      std::vector<int> &adj = vars[i];
+      adj.erase(std::remove_if(adj.begin(), adj.end(), [&](int v) { return eliminated[v] || mark[v] == k; }), adj.end());
+
+      std::vector<int> &el = elems[i];
+      int d = (int) adj.size() + (int) lp.size() - 1;
+      for (int e : el) {
+        if (absorbed[e]) continue;
+        if (outside[e] == 0) { absorbed[e] = 1; std::vector<int>().swap(members[e]); continue; } // inside Lp
+        d += outside[e];
+      }
+      el.erase(std::remove_if(el.begin(), el.end(), [&](int e) { return absorbed[e] != 0; }), el.end());
+      el.push_back(p);
+
+      d = std::min(d, n - k - 2);
+      if (d != degree[i]) {
+        queue.erase({ degree[i], i });
+        degree[i] = d;
+        queue.insert({ d, i });
+      }
+    }
+
+    for (int i : lp) {
+      for (int e : elems[i]) outside[e] = -1;
+    }
+    members[p] = std::move(lp);
+  }
+
+  return order;
+}
@@ -0,0 +1,288 @@
+/**
+ * A determinant engine for large sparse matrices. The matrix is compressed by rows and
+ * by columns, its rows and columns are renumbered by an approximate minimum degree
+ * ordering of the pattern of A + A^T so that elimination creates little fill, and it is
+ * factored by a right looking sparse LU with threshold pivoting. The cost follows the
+ * non-zeros of the factors rather than n^3.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "deter.h"
+
+namespace deter {
+
+  /**
+   * The density below which a matrix is handed to the sparse engine when the engines are
+   * chosen automatically (deter -z), and the smallest order that is worth it.
+   */
+  const double SPARSE_DENSITY = 0.05;
+  const int SPARSE_MIN_ORDER = 100;
+
+  /**
+   * The threshold of the pivoting: any candidate within this factor of the largest
+   * magnitude in its column may be the pivot, the one with the shortest row is.
+   */
+  const double SPARSE_PIVOT = 0.1;
+
+  /**
+   * Once this fraction of what is left of the matrix is non-zero, sparse elimination
+   * only costs more than dense, and the rest is handed to factorBlockedLU.
+   */
+  const double SPARSE_DENSE_SWITCH = 0.2;
+
+  /**
+   * The positions of the non-zeros of a compressed matrix: line i (a row for CSR, a
+   * column for CSC) holds the entries start[i] to start[i + 1] - 1, index telling their
+   * column (or row), in increasing order.
+   */
+  struct sparse_pattern {
+    int n = 0;
+    std::vector<int> start;
+    std::vector<int> index;
+  };
+
+  /**
+   * A compressed matrix, the values alongside the pattern.
+   */
+  template<typename F>
+    struct compressed : sparse_pattern {
+      std::vector<F> value;
+    };
+
+  /**
+   * An approximate minimum degree ordering of the graph of A + A^T, in the manner of AMD:
+   * eliminated nodes become elements standing for the clique they create, so the graph
+   * never grows, and degrees are the approximate external degrees. Elements contained in
+   * the newest one are absorbed.
+   *
+   * @param rows - the pattern of A by rows.
+   * @param cols - the pattern of A by columns.
+   * @return the nodes in elimination order.
+   */
+  std::vector<int> minimumDegreeOrder(const sparse_pattern &rows, const sparse_pattern &cols);
+
+  /**
+   * Compresses a matrix by rows (CSR), leaving out its zeros.
+   */
+  template<typename F, typename T>
+    compressed<F> compressRows(const Matrix<T> &matrix) {
+      compressed<F> c;
+      c.n = matrix.order();
+      c.start.reserve(c.n + 1);
+      c.start.push_back(0);
+      for (int i=0; i < c.n; i++) {
+        const T *row = matrix.row(i);
+        for (int j=0; j < c.n; j++) {
+          if (row[j] == 0) continue;
+          c.index.push_back(j);
+          c.value.push_back((F) row[j]);
+        }
+        c.start.push_back((int) c.index.size());
+      }
+      return c;
+    }
+
+  /**
+   * The transpose of a compressed matrix, which turns CSR into CSC and back.
+   */
+  template<typename F>
+    compressed<F> transpose(const compressed<F> &a) {
+      compressed<F> t;
+      t.n = a.n;
+      t.start.assign(a.n + 1, 0);
+      for (int k : a.index) t.start[k + 1]++;
+      for (int i=0; i < a.n; i++) t.start[i + 1] += t.start[i];
+
+      t.index.resize(a.index.size());
+      t.value.resize(a.value.size());
+      std::vector<int> next(t.start.begin(), t.start.end() - 1);
+      for (int i=0; i < a.n; i++) {
+        for (int k=a.start[i]; k < a.start[i + 1]; k++) {
+          const int at = next[a.index[k]]++;
+          t.index[at] = i;
+          t.value[at] = a.value[k];
+        }
+      }
+      return t;
+    }
+
+  /**
+   * The determinant of a compressed matrix by sparse LU, taking the rows and columns in
+   * the given order. The active rows are kept as sorted lists of (column, value) and are
+   * eliminated column by column; the pivot of a column is, among the rows whose
+   * magnitude is within threshold of the largest, the one with the fewest entries, the
+   * diagonal on a tie, so the ordering is followed wherever the values allow it. When
+   * the fill has made the rows left dense enough (SPARSE_DENSE_SWITCH) they are finished
+   * as a dense matrix.
+   *
+   * @param rows - the matrix by rows.
+   * @param order - the elimination order of the rows and columns.
+   * @param threshold - the pivoting threshold, in (0, 1].
+   * @return the determinant.
+   */
+  template<typename F>
+    F sparseLU(const compressed<F> &rows, const std::vector<int> &order, const double threshold) {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      struct entry {
+        int col;
+        F value;
+      };
+
+      const int n = rows.n;
+      std::vector<int> position(n);
+      for (int k=0; k < n; k++) position[order[k]] = k;
+
+      // the permuted matrix by rows, and for every column the rows that may hold it
+      std::vector<std::vector<entry>> active(n);
+      std::vector<std::vector<int>> holders(n);
+      for (int r=0; r < n; r++) {
+        const int i = order[r];
+        std::vector<entry> &row = active[r];
+        for (int k=rows.start[i]; k < rows.start[i + 1]; k++) row.push_back({ position[rows.index[k]], rows.value[k] });
+        std::sort(row.begin(), row.end(), [](const entry &a, const entry &b) { return a.col < b.col; });
+        for (const entry &e : row) holders[e.col].push_back(r);
+      }
+      size_t live = rows.index.size(); // the entries in active
+
+      // every active row starts at a column >= k, a row holds column k iff it starts there
+      auto leads = [&](const int r, const int k) { return !active[r].empty() && active[r][0].col == k; };
+
+      std::vector<int> pivot_row(n);
+      std::vector<unsigned char> taken(n, 0);
+      std::vector<entry> merged;
+      F det = 1;
+      for (int k=0; k < n; k++) {
+        const int left = n - k;
+        if (left >= 2 * BLOCK_SIZE && live >= SPARSE_DENSE_SWITCH * left * left) {
+          // the remaining rows in any order, the dense factorization pivots among them
+          Matrix<F> dense(left);
+          for (int r=0, i=0; r < n; r++) {
+            if (taken[r]) continue;
+            for (const entry &e : active[r]) dense(i, e.col - k) = e.value;
+            pivot_row[k + i++] = r;
+          }
+          std::vector<int> piv(left);
+          det *= factorBlockedLU(left, dense.data(), dense.stride(), piv.data());
+          for (int i=0; i < left; i++) det *= dense(i, i);
+          break;
+        }
+
+        F best = 0;
+        for (int r : holders[k]) {
+          if (leads(r, k)) best = std::max(best, std::abs(active[r][0].value));
+        }
+        if (best == 0) return 0; // an empty column, the matrix is singular
+
+        int p = -1;
+        for (int r : holders[k]) {
+          if (!leads(r, k) || std::abs(active[r][0].value) < threshold * best) continue;
+          if (p < 0 || active[r].size() < active[p].size() || (active[r].size() == active[p].size() && r == k)) p = r;
+        }
+
+        pivot_row[k] = p;
+        const std::vector<entry> &u = active[p];
+        const F pivot = u[0].value;
+        det *= pivot;
+
+        for (int r : holders[k]) {
+          if (r == p || !leads(r, k)) continue;
+
+          // row r -= l * row p, past column k
+          const std::vector<entry> &a = active[r];
+          const F l = a[0].value / pivot;
+          merged.clear();
+          size_t x = 1, y = 1;
+          while (x < a.size() || y < u.size()) {
+            if (y == u.size() || (x < a.size() && a[x].col < u[y].col)) {
+              merged.push_back(a[x++]);
+            } else if (x == a.size() || u[y].col < a[x].col) {
+              merged.push_back({ u[y].col, -l * u[y].value });
+              holders[u[y].col].push_back(r); // fill
+              y++;
+            } else {
+              const F v = a[x].value - l * u[y].value;
+              if (v != 0) merged.push_back({ a[x].col, v });
+              x++;
+              y++;
+            }
+          }
+          live += merged.size();
+          live -= a.size();
+          active[r].swap(merged);
+        }
+
+        live -= u.size();
+        taken[p] = 1;
+        std::vector<entry>().swap(active[p]);
+        std::vector<int>().swap(holders[k]);
+      }
+
+      // the sign of the row permutation
+      if (permutationSign(pivot_row) < 0) det = -det;
+
+      if (det == 0) det = 0; // no negative zero in the report
+      return det;
+    }
+
+  /**
+   * Tells whether a matrix is sparse enough for computeDeterminantSparse: an order of at
+   * least SPARSE_MIN_ORDER and fewer than density * n^2 non-zeros. The count stops as soon
+   * as the limit is passed.
+   *
+   * @param matrix - the matrix.
+   * @param density - the largest fraction of non-zeros.
+   * @return true for a sparse matrix.
+   */
+  template<typename T>
+    bool isSparse(const Matrix<T> &matrix, const double density) {
+      const int n = matrix.order();
+      if (n < SPARSE_MIN_ORDER) return false;
+
+      const double limit = density * n * n;
+      size_t count = 0;
+      for (int i=0; i < n; i++) {
+        const T *row = matrix.row(i);
+        for (int j=0; j < n; j++) count += (row[j] != 0);
+        if (count >= limit) return false;
+      }
+      return true;
+    }
+
+  /**
+   * Computes the determinant with a sparse LU after a minimum degree ordering. For
+   * sparse matrices the cost and the memory follow the fill of the factors, for dense
+   * ones it is computeDeterminantLU with more bookkeeping. Integer matrices are factored
+   * in double and the result rounded.
+   *
+   * @param matrix - The matrix data.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T>
+    T computeDeterminantSparse(const Matrix<T> &matrix) {
+      static_assert(std::is_arithmetic<T>::value, "Arithmetic type is required.");
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+      if (matrix.order() < 1) return 0;
+
+      const compressed<F> rows = compressRows<F>(matrix);
+      const compressed<F> cols = transpose(rows);
+      F det = sparseLU(rows, minimumDegreeOrder(rows, cols), SPARSE_PIVOT);
+
+      if (std::is_integral<T>::value) return static_cast<T>(std::llround(det));
+      return static_cast<T>(det);
+    }
+
+}
+
+#endif
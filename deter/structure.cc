@@ -0,0 +1,18 @@
+#include "structure.h"
+
+/**
+ * Implementation for the structured matrix fast paths.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+const char* deter::structureName(structure kind) {
+  switch (kind) {
+    case diagonal: return "diagonal";
+    case upper_triangular: return "upper triangular";
+    case lower_triangular: return "lower triangular";
+    case permutation: return "permutation";
+    case banded: return "banded";
+    default: return "general";
+  }
+}
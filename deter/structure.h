@@ -0,0 +1,258 @@
+/**
+ * Fast paths for matrices with a structure that gives the determinant away. A single
+ * O(n^2) pass over the matrix, which stops as soon as no structure is left to find,
+ * sorts it into one of the shapes below: triangular and diagonal matrices are the
+ * product of their diagonal, a permutation-like matrix (one non-zero in every row and
+ * column) is the sign of its permutation times the product of its non-zeros, and a
+ * banded matrix is factored by an LU that only ever touches its band. Everything else
+ * goes to the engine that was chosen.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "deter.h"
+
+namespace deter {
+
+  /**
+   * The shapes detectStructure recognises, the path a determinant was computed by.
+   */
+  enum structure { general, diagonal, upper_triangular, lower_triangular, permutation, banded };
+
+  /**
+   * @return a printable name for the structure.
+   */
+  const char* structureName(structure kind);
+
+  /**
+   * What detectStructure found. lower and upper are the bandwidths, the furthest any
+   * non-zero lies below and above the diagonal; they are exact for the triangular and
+   * banded shapes only, since the scan stops once the shape is known to be general.
+   */
+  struct matrix_shape {
+    structure kind = general;
+    int lower = 0;
+    int upper = 0;
+  };
+
+  /**
+   * A determinant together with the path that computed it, so the report can show it.
+   */
+  template<typename R>
+    struct structured {
+      R value;
+      structure path;
+    };
+
+  /**
+   * Classifies a matrix in one pass over its rows, stopping as soon as it can only be
+   * general. A band is only worth it while it is narrow: 2 * (lower + upper) < n.
+   *
+   * @param matrix - the matrix.
+   * @return its shape.
+   */
+  template<typename T>
+    matrix_shape detectStructure(const Matrix<T> &matrix) {
+      const int n = matrix.order();
+      matrix_shape shape;
+      if (n < 1) return shape;
+
+      std::vector<unsigned char> taken(n, 0);
+      bool monomial = true; // one non-zero in every row and every column so far
+
+      for (int i=0; i < n; i++) {
+        const T *row = matrix.row(i);
+        int first = -1, last = -1, count = 0;
+        for (int j=0; j < n; j++) {
+          if (row[j] == T()) continue;
+          if (first < 0) first = j;
+          last = j;
+          count++;
+        }
+
+        if (count != 1 || taken[first]) monomial = false;
+        else taken[first] = 1;
+
+        if (count > 0) {
+          shape.lower = std::max(shape.lower, i - first);
+          shape.upper = std::max(shape.upper, last - i);
+        }
+
+        if (!monomial && shape.lower > 0 && shape.upper > 0 && 2 * (shape.lower + shape.upper) >= n) return shape;
+      }
+
+      if (shape.lower == 0 && shape.upper == 0) shape.kind = diagonal;
+      else if (shape.lower == 0) shape.kind = upper_triangular;
+      else if (shape.upper == 0) shape.kind = lower_triangular;
+      else if (monomial) shape.kind = permutation;
+      else if (2 * (shape.lower + shape.upper) < n) shape.kind = banded;
+      return shape;
+    }
+
+  /**
+   * The determinant of a triangular or diagonal matrix: the product of its diagonal,
+   * multiplied out in the order the elimination engines use.
+   *
+   * @param matrix - the matrix.
+   * @return the determinant.
+   */
+  template<typename T>
+    T diagonalProduct(const Matrix<T> &matrix) {
+      T det = 1;
+      for (int k=0; k < matrix.order(); k++) det *= matrix(k, k);
+      if (det == 0) det = 0; // no negative zero in the report
+      return det;
+    }
+
+  /**
+   * The determinant of a matrix with exactly one non-zero in every row and column: the
+   * sign of the permutation of the columns times the product of the non-zeros.
+   *
+   * @param matrix - the matrix.
+   * @return the determinant.
+   */
+  template<typename T>
+    T permutationDeterminant(const Matrix<T> &matrix) {
+      const int n = matrix.order();
+      std::vector<int> column(n);
+      T det = 1;
+      for (int i=0; i < n; i++) {
+        const T *row = matrix.row(i);
+        column[i] = (int) (std::find_if(row, row + n, [](const T v) { return v != T(); }) - row);
+        det *= row[column[i]];
+      }
+
+      if (permutationSign(column) < 0) det = -det;
+      if (det == 0) det = 0;
+      return det;
+    }
+
+  /**
+   * LU with partial pivoting of a matrix held as its band, row i keeping the columns
+   * i - lower to i + upper + lower: the row swaps can widen the upper band by lower. The
+   * pivots and the arithmetic are those of factorLU with the scalar kernels, everything
+   * outside the band being zero, at a cost of O(n * lower * (lower + upper)).
+   *
+   * @param n - the order of the matrix.
+   * @param lower - the lower bandwidth.
+   * @param upper - the upper bandwidth.
+   * @param ab - the band, n rows of 2 * lower + upper + 1 values, overwritten.
+   * @return the sign of the row permutation, 1 or -1.
+   */
+  template<typename F>
+    int factorBanded(const int n, const int lower, const int upper, F *ab) {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      const int width = (2 * lower) + upper + 1;
+      auto at = [&](const int i, const int j) -> F& { return ab[((size_t) width * i) + (j - i + lower)]; };
+
+      int sign = 1;
+      for (int k=0; k < n; k++) {
+        const int last_row = std::min(n - 1, k + lower);
+        const int last_col = std::min(n - 1, k + lower + upper);
+
+        int p = k;
+        F best = std::abs(at(k, k));
+        for (int i=k+1; i <= last_row; i++) {
+          F v = std::abs(at(i, k));
+          if (v > best) { best = v; p = i; }
+        }
+
+        if (best == 0) continue; // nothing to eliminate
+
+        if (p != k) {
+          for (int j=k; j <= last_col; j++) std::swap(at(k, j), at(p, j));
+          sign = -sign;
+        }
+
+        for (int i=k+1; i <= last_row; i++) {
+          F l = at(i, k) / at(k, k);
+          at(i, k) = l;
+          if (l == 0) continue;
+          for (int j=k+1; j <= last_col; j++) at(i, j) -= l * at(k, j);
+        }
+      }
+
+      return sign;
+    }
+
+  /**
+   * The determinant of a banded matrix by factorBanded. Integer matrices are factored in
+   * double and the result rounded, as computeDeterminantLU does.
+   *
+   * @param matrix - the matrix.
+   * @param lower - its lower bandwidth.
+   * @param upper - its upper bandwidth.
+   * @return the determinant.
+   */
+  template<typename T>
+    T bandedDeterminant(const Matrix<T> &matrix, const int lower, const int upper) {
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+      const int n = matrix.order();
+      const int width = (2 * lower) + upper + 1;
+      std::vector<F> ab((size_t) width * n, F());
+      for (int i=0; i < n; i++) {
+        const T *row = matrix.row(i);
+        for (int j=std::max(0, i - lower); j <= std::min(n - 1, i + upper); j++) ab[((size_t) width * i) + (j - i + lower)] = row[j];
+      }
+
+      F det = factorBanded(n, lower, upper, ab.data());
+      for (int k=0; k < n; k++) det *= ab[((size_t) width * k) + lower];
+      if (det == 0) det = 0;
+
+      if (std::is_integral<T>::value) return static_cast<T>(std::llround(det));
+      return static_cast<T>(det);
+    }
+
+  /**
+   * Computes the determinant by the fast path for the structure of the matrix, or with
+   * the given engine when it has none.
+   *
+   * @param matrix - the matrix.
+   * @param fallback - the engine for general matrices.
+   * @param exact - true for an exact fallback (cofactor, dp, bareiss), which then takes the
+   * banded matrices too: the band LU rounds like any LU, the other paths only multiply.
+   * @return the determinant and the path that computed it.
+   */
+  template<typename T, typename Compute>
+    structured<T> computeDeterminantStructured(const Matrix<T> &matrix, Compute fallback, const bool exact = false) {
+      const matrix_shape shape = detectStructure(matrix);
+      switch (shape.kind) {
+        case diagonal:
+        case upper_triangular:
+        case lower_triangular:
+          return { diagonalProduct(matrix), shape.kind };
+        case permutation:
+          return { permutationDeterminant(matrix), shape.kind };
+        case banded:
+          if (exact) return { fallback(matrix), general };
+          return { bandedDeterminant(matrix, shape.lower, shape.upper), shape.kind };
+        default:
+          return { fallback(matrix), general };
+      }
+    }
+
+  /**
+   * The determinant in a report followed by its path, as in "= det(M) = 6 [diagonal]".
+   */
+  template<typename R>
+    void reportValue(std::ostream &outs, std::string &text, const structured<R> &deter, const int precision) {
+      reportValue(outs, text, deter.value, precision);
+      text += " [";
+      text += structureName(deter.path);
+      text += ']';
+    }
+
+}
+
+#endif
@@ -40,4 +40,123 @@ const char* ALL_MATRIX = R"(
 1 1 1 1 1 1 
 )";
 
+// the contents of wild_input.txt, line ends as they are
+const char* WILD_MATRIX =
+  "\r\n"
+  "\r\n"
+  "\r\n"
+  "1\r\n"
+  "\r\n"
+  "5\r\n"
+  "\r\n"
+  "\r\n"
+  "\r\n"
+  "2           \r\n"
+  "2 3 \r\n"
+  "5 9 \r\n"
+  "\r\n"
+  "3\r\n"
+  "\r\n"
+  "3 -2 4 \r\n"
+  "-1 5 2 \r\n"
+  "-3 6 4 \r\n"
+  "4\r\n"
+  "2 4 5 6 \r\n"
+  "\r\n"
+  "0 3 6 9 \r\n"
+  "\r\n"
+  "0 0 9 8 \r\n"
+  "\r\n"
+  "0 0 0 5 \r\n"
+  "\r\n"
+  "\r\n"
+  "4\r\n"
+  "2 4 5 6 \r\n"
+  "0 0 0 0 \r\n"
+  "0 0 9 8 \r\n"
+  "0 0 0 5 \r\n"
+  "4\r\n"
+  "2 0 0 0 \r\n"
+  "0 3 0 0 \r\n"
+  "0 0 9 0 \r\n"
+  "0 0 0 5 \r\n"
+  "4\r\n"
+  "2 4 0 6 \r\n"
+  "1 3 0 0 \r\n"
+  "4 0 0 8 \r\n"
+  "2 5 0 5 \r\n"
+  "\r\n"
+  "\r\n"
+  "6\r\n"
+  "6 4 6 4 6 4 \r\n"
+  "\r\n"
+  "\r\n"
+  "\r\n"
+  "1 2 3 4 5 6 \r\n"
+  "6 5 4 3 2 1 \r\n"
+  "\r\n"
+  "\r\n"
+  "\r\n"
+  "3 2 3 2 3 2 \r\n"
+  "4 6 4 6 4 6 \r\n"
+  "1 1 1 1 1 1 \r\n";
+
+// the contents of err_input.txt, line ends as they are
+const char* ERR_MATRIX =
+  "1\r\n"
+  "5\r\n"
+  "2\r\n"
+  "2 3 \r\n"
+  "5 9 \r\n"
+  "3\r\n"
+  "3 -2 4 \r\n"
+  "-1 5 2 \r\n"
+  "-3 6 4 \r\n"
+  "4\r\n"
+  "2 4 5 6 8\r\n"
+  "0 3 6 9 \r\n"
+  "0 0 9 8 \r\n"
+  "0 0 0 5 \r\n"
+  "4\r\n"
+  "2 4 5 6 \r\n"
+  "0 0 0 0 \r\n"
+  "0 0 9 8 \r\n"
+  "0 0 0 5 \r\n"
+  "4\r\n"
+  "2 0 0 0 \r\n"
+  "0 3 0 0 \r\n"
+  "0 0 9 0 \r\n"
+  "0 0 0 5 \r\n"
+  "4\r\n"
+  "2 4 0 6 \r\n"
+  "1 3 0 0 \r\n"
+  "4 0 0 8 \r\n"
+  "2 5 0 5 \r\n"
+  "6\r\n"
+  "6 4 6 4 6 4 \r\n"
+  "1 2 3 4 5 6 \r\n"
+  "6 5 4 3 2 1 \r\n"
+  "3 2 3 2 3 2 \r\n"
+  "4 6 4 6 4 6 \r\n"
+  "1 1 1 1 1 1 \r\n";
+
+// the contents of random_data.txt, line ends as they are
+const char* RANDOM_MATRIX =
+  "3\n"
+  "1 2 3\n"
+  "4 5 6\n"
+  "7 8 9\n"
+  "1 2 1\n"
+  "3\n"
+  "11 22 33 44\n"
+  "6 8 9\n"
+  "9 9 9)\n";
+
+// the contents of real_input.txt, line ends as they are
+const char* REAL_MATRIX =
+  "3\r\n"
+  "3.45 -2.2 4 \r\n"
+  "-1 5.999 2 \r\n"
+  "-3 6.7 4.1 \r\n";
+
 #endif
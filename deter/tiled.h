@@ -0,0 +1,193 @@
+/**
+ * A tile based parallel LU decomposition in the style of PLASMA. The matrix is cut into
+ * square tiles and the factorization into three kinds of task:
+ *
+ *   panel(k)      factor the k-th column of tiles with partial pivoting
+ *   swap(k, j)    apply the pivots of panel k to the j-th column of tiles and solve for
+ *                 the U tile on the diagonal row, U(k,j) = L(k,k)^-1 A(k,j)
+ *   update(k,i,j) A(i,j) -= L(i,k) * U(k,j)
+ *
+ * Each task is queued on a ThreadPool as soon as the tasks it depends on are done, there
+ * is no barrier between steps. In particular panel(k+1) only waits on the updates of its
+ * own column, so it runs while the rest of the trailing matrix of step k is still being
+ * updated (look ahead), which keeps the panel off the critical path.
+ *
+ * @author Donovan Nye <donovan.nye@gmail.com>
+ * @module 7 - 602.202.82
+ */
+#ifndef TILED_H
+#define TILED_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "deter.h"
+#include "kernels.h"
+#include "pool.h"
+
+namespace deter {
+
+  /**
+   * The edge of the square tiles used by factorTiledLU.
+   */
+  const int TILE_SIZE = 128;
+
+  /**
+   * Factors the n x n row-major matrix a in place, in parallel on the given pool. The
+   * pivots are the same as factorLU would choose, but they are only applied to the
+   * columns to the right of each panel, the rows of L are left where they were computed.
+   * That is all a determinant needs (U and the sign of the permutation are the same),
+   * but the lower triangle is not usable as L of the permuted matrix.
+   *
+   * @param n - the order of the matrix.
+   * @param a - the matrix data, overwritten by the factors.
+   * @param lda - the distance between the start of consecutive rows.
+   * @param piv - receives the pivot row chosen for each column (n entries).
+   * @param pool - the threads to run the tasks on.
+   * @param nb - the tile size.
+   * @return the sign of the row permutation, 1 or -1.
+   */
+  template<typename F>
+    int factorTiledLU(const int n, F *a, const int lda, int *piv, ThreadPool &pool, const int nb = TILE_SIZE) {
+      static_assert(std::is_floating_point<F>::value, "Floating point type is required.");
+
+      const int nt = (n + nb - 1) / nb;
+      auto lo = [nb](int t) { return t * nb; };
+      auto hi = [nb, n](int t) { return std::min((t + 1) * nb, n); };
+
+      // number of tasks each panel and swap is still waiting on
+      std::unique_ptr<std::atomic<int>[]> panel_deps(new std::atomic<int>[nt]);
+      std::unique_ptr<std::atomic<int>[]> swap_deps(new std::atomic<int>[nt * nt]);
+      std::vector<int> panel_sign(nt, 1);
+
+      long total = 0;
+      for (int k=0; k < nt; k++) {
+        panel_deps[k] = (k == 0) ? 0 : nt - k;
+        for (int j=k+1; j < nt; j++) swap_deps[(nt * k) + j] = 1 + ((k == 0) ? 0 : nt - k);
+        total += 1 + (long) (nt - k - 1) * (nt - k);
+      }
+      std::atomic<long> remaining { total };
+
+      std::function<void(int)> panel;
+      std::function<void(int, int)> swap;
+      std::function<void(int, int, int)> update;
+
+      panel = [&](int k) {
+        const int k0 = lo(k), k1 = hi(k);
+        int sign = 1;
+
+        for (int kk=k0; kk < k1; kk++) {
+          int p = kk;
+          F best = std::abs(a[(lda * kk) + kk]);
+          for (int i=kk+1; i < n; i++) {
+            F v = std::abs(a[(lda * i) + kk]);
+            if (v > best) { best = v; p = i; }
+          }
+
+          piv[kk] = p;
+          if (best == 0) continue;
+
+          if (p != kk) {
+            std::swap_ranges(a + (lda * kk) + k0, a + (lda * kk) + k1, a + (lda * p) + k0);
+            sign = -sign;
+          }
+
+          const F *rk = a + (lda * kk);
+          for (int i=kk+1; i < n; i++) {
+            F *ri = a + (lda * i);
+            F l = ri[kk] / rk[kk];
+            ri[kk] = l;
+            if (l == 0) continue;
+            eliminate(k1 - kk - 1, l, rk + kk + 1, ri + kk + 1);
+          }
+        }
+
+        panel_sign[k] = sign;
+        for (int j=k+1; j < nt; j++) {
+          if (--swap_deps[(nt * k) + j] == 0) pool.submit([&swap, k, j]() { swap(k, j); });
+        }
+
+        remaining--;
+      };
+
+      swap = [&](int k, int j) {
+        const int k0 = lo(k), k1 = hi(k), j0 = lo(j), j1 = hi(j);
+
+        for (int kk=k0; kk < k1; kk++) {
+          if (piv[kk] != kk) {
+            std::swap_ranges(a + (lda * kk) + j0, a + (lda * kk) + j1, a + (lda * piv[kk]) + j0);
+          }
+        }
+
+        for (int r=k0+1; r < k1; r++) {
+          F *rr = a + (lda * r);
+          for (int q=k0; q < r; q++) {
+            F l = rr[q];
+            if (l == 0) continue;
+            eliminate(j1 - j0, l, a + (lda * q) + j0, rr + j0);
+          }
+        }
+
+        for (int i=k+1; i < nt; i++) pool.submit([&update, k, i, j]() { update(k, i, j); });
+
+        remaining--;
+      };
+
+      update = [&](int k, int i, int j) {
+        const int k0 = lo(k), k1 = hi(k), j0 = lo(j), j1 = hi(j);
+
+        for (int r=lo(i); r < hi(i); r++) {
+          F *rr = a + (lda * r);
+          int q = k0;
+          for (; q + 4 <= k1; q += 4) {
+            const F *r0 = a + (lda * q) + j0;
+            eliminate4(j1 - j0, rr + q, r0, r0 + lda, r0 + (2 * lda), r0 + (3 * lda), rr + j0);
+          }
+          for (; q < k1; q++) {
+            F l = rr[q];
+            if (l == 0) continue;
+            eliminate(j1 - j0, l, a + (lda * q) + j0, rr + j0);
+          }
+        }
+
+        // this tile is one of the inputs to the next step on column j
+        if (j == k + 1) {
+          if (--panel_deps[k+1] == 0) pool.submit([&panel, k]() { panel(k + 1); });
+        } else {
+          if (--swap_deps[(nt * (k + 1)) + j] == 0) pool.submit([&swap, k, j]() { swap(k + 1, j); });
+        }
+
+        remaining--;
+      };
+
+      pool.submit([&panel]() { panel(0); });
+      pool.wait_until([&remaining]() { return remaining == 0; });
+
+      int sign = 1;
+      for (int s : panel_sign) sign *= s;
+      return sign;
+    }
+
+  /**
+   * Computes the determinant with factorTiledLU, spreading the work of a single matrix
+   * over every thread of the pool. Matrices that fit in a single tile are not worth the
+   * scheduling and go through factorBlockedLU on the calling thread.
+   *
+   * @param matrix - The matrix data.
+   * @param pool - the threads to use.
+   * @return the determinant for the given matrix.
+   */
+  template<typename T>
+    T computeDeterminantTiled(const Matrix<T> &matrix, ThreadPool &pool) {
+      using F = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+      return eliminationDeterminant(matrix, [&pool](const int n, F *a, const int lda, int *piv) {
+          if (n <= TILE_SIZE) return factorBlockedLU(n, a, lda, piv);
+          return factorTiledLU(n, a, lda, piv, pool);
+      });
+    }
+
+}
+
+#endif